@@ -1,9 +1,6 @@
 #include "assembler.hpp"
 #include "exceptions.hpp"
 
-int Assembler::sectionId = 0;
-int Assembler::symbolId = 0;
-
 /**
  * @brief Construct a new Assembler:: Assembler object
  * 
@@ -13,6 +10,8 @@ int Assembler::symbolId = 0;
 Assembler::Assembler(string outputFile, string inputFile) throw(){
   this->outputFileString = outputFile;
   this->inputFileString = inputFile;
+  this->sectionId = 0;
+  this->symbolId = 0;
 
   Section section;
   section.id = sectionId++;
@@ -20,6 +19,7 @@ Assembler::Assembler(string outputFile, string inputFile) throw(){
   section.length = 0;
   section.name = "UND";
   sectionTable.push_back(section);
+  machineCode.push_back(vector<uint8_t>());
 
   Symbol symbol;
   symbol.id = symbolId++;
@@ -31,77 +31,8 @@ Assembler::Assembler(string outputFile, string inputFile) throw(){
   symbol.type = SCTN;
   symbol.bind = NOBIND;
   symbol.defined = false;
-  symbolTable.push_back(symbol);
-
-}
-
-/**
- * @brief turns hex number to machine code
- * 
- * @param num the number that need to be changed
- * @return vector<string> helper machine code
- */
-vector<string> Assembler::hexToCode(string num){
-
-  vector<string> ret;
-  if(num.size() == 4){
-    ret.push_back(num.substr(0,2));
-    ret.push_back(num.substr(2,2));
-  } else {
-    if(num.size() == 3){
-      ret.push_back("0" + num.substr(0,1));
-      ret.push_back(num.substr(1,2));
-    } else {
-      if(num.size() == 2){
-        ret.push_back("00");
-        ret.push_back(num.substr(0,2));
-      } else {
-        ret.push_back("00");
-        ret.push_back("0" + num);
-      }
-    }
-  }
-  return ret;
-}
+  addSymbol(symbol);
 
-/**
- * @brief turns dec number to machine code
- * 
- * @param num the number that need to be changed
- * @return vector<string> helper machine code
- */
-vector<string> Assembler::decToCode(string num){
-  vector<string> ret;
-  
-  int n = stoi(num);
-  char help[8];
-  sprintf(help, "%X", n);
-  string help1 = (string)help;
-
-  if(help1.size() == 4){
-    ret.push_back(help1.substr(0,2));
-    ret.push_back(help1.substr(2,2));
-  } else {
-    if(help1.size() == 3){
-      ret.push_back("0" + help1.substr(0,1));
-      ret.push_back(help1.substr(1,2));
-    } else {
-      if(help1.size() == 2){
-        ret.push_back("00");
-        ret.push_back(help1.substr(0,2));
-      } else {
-        if(help1.size() == 1){
-          ret.push_back("00");
-          ret.push_back("0" + help1);
-        } else {  // here it means it is negative number
-          ret.push_back(help1.substr(4,2));
-          ret.push_back(help1.substr(6,2));
-        }        
-      }
-    }
-  }
-
-  return ret;
 }
 
 /**
@@ -122,45 +53,37 @@ bool Assembler::openFiles(){
 }
 
 /**
- * @brief we pass through the input file and remove comments, tabs, extra spaces, etc.
+ * @brief search for symbol and search if symbol is defined
  * 
+ * @param symbolName symbol's name
+ * @return int -1 - no symbol, num - symbol found
  */
-void Assembler::setGoodLines(){
-
-  string line;
-
-  while(getline(this->inputFile, line)){
-
-    string newLine;
-
-    newLine = regex_replace(line, commentsRegex, "");
-    newLine = regex_replace(newLine, tabsRegex, " ");
-    newLine = regex_replace(newLine, extraSpacesRegex, " ");
-    newLine = regex_replace(newLine, startSpacesRegex, "");
-    newLine = regex_replace(newLine, endSpacesRegex, "");
-
-    goodLines.push_back(newLine);
-
-  }
+int Assembler::searchSymbol(const string& symbolName){
 
+  unordered_map<string, int>::const_iterator found = symbolIndex.find(symbolName);
+  if(found == symbolIndex.end()) return -1;
+  return found->second;
 }
 
 /**
- * @brief search for symbol and search if symbol is defined
+ * @brief adds symbol at the end of symbol table and to name index
  * 
- * @param symbolName symbol's name
- * @return int -1 - no symbol, num - symbol found
+ * @param sym symbol that is added, its name mustn't be in table already
  */
-int Assembler::searchSymbol(string symbolName){
+void Assembler::addSymbol(const Symbol& sym){
+  symbolIndex[sym.name] = symbolTable.size();
+  symbolTable.push_back(sym);
+}
 
-  int cnt = 0;
-  for(Symbol sym: symbolTable){
-    if(sym.name == symbolName){
-      return cnt;
-    }
-    cnt++;
-  }
-  return -1;
+/**
+ * @brief writes byte as two uppercase hex digits, stream flags are not changed
+ * 
+ * @param out stream
+ * @param byte byte that is written
+ */
+static void writeHexByte(ostream& out, uint8_t byte){
+  static const char digits[] = "0123456789ABCDEF";
+  out << digits[byte >> 4] << digits[byte & 0xF];
 }
 
 /**
@@ -169,56 +92,41 @@ int Assembler::searchSymbol(string symbolName){
  */
 void Assembler::printOutput(){
 
-  size_t lastindex = outputFileString.find_last_of(".");
-  string outputLinker = "linker." + outputFileString.substr(0, lastindex) + ".o";
-  ofstream outputLinkerStream;
-  outputLinkerStream.open(outputLinker, ios::out|ios::trunc);
-
   this->outputFile << "SECTION TABLE\n";
   this->outputFile << "ID" << "\t" << "LENGTH" << "\t" << "NAME" << "\n";
-  outputLinkerStream << "SECTIONS\n";
-  for(Section s: sectionTable){
+  for(const Section& s: sectionTable){
     this->outputFile << s.id << "\t" << s.length << "\t" << s.name << "\n";
-    outputLinkerStream << s.id << "\t" << s.length << "\t" << s.name << "\n";
   }
 
   this->outputFile << endl;
-  outputLinkerStream << endl;
 
   this->outputFile << "SYMBOL TABLE\n";
   this->outputFile << "Num\tValue\tType\tBind\tNdx\tName\tDefined\n";
-  outputLinkerStream << "SYMBOLS\n";
-  for(Symbol sym: symbolTable){
+  for(const Symbol& sym: symbolTable){
     this->outputFile << sym.id << "\t" << std::setfill('0') << std::setw(4) << std::hex << sym.offset << std::dec << "\t"; 
-    outputLinkerStream << sym.id << "\t" << std::setfill('0') << std::setw(4) << std::hex << sym.offset << std::dec << "\t"; 
 
     switch(sym.type){
 
       case NOTYP:
         this->outputFile << "NOTYP\t";
-        outputLinkerStream << "NOTYP\t";
         break;
       
       case SCTN:
         this->outputFile << "SCTN\t";
-        outputLinkerStream << "SCTN\t";
         break;
     }
 
     switch(sym.bind){
       case GLOBAL:
         this->outputFile << "GLOB\t";
-        outputLinkerStream << "GLOB\t";
         break;
 
       case LOCAL:
         this->outputFile << "LOC\t";
-        outputLinkerStream << "LOC\t";
         break;
 
       case NOBIND:
         this->outputFile << "NOBIND\t";
-        outputLinkerStream << "NOBIND\t";
         break;
     }
 
@@ -226,126 +134,94 @@ void Assembler::printOutput(){
 
       case 0:
         this->outputFile << "UND\t";
-        outputLinkerStream << "UND\t";
         break;
 
       default:
         this->outputFile << sym.sectionId << "\t";
-        outputLinkerStream << sym.sectionId << "\t";
         break;
     }
 
     this->outputFile << sym.name << "\t";
-    outputLinkerStream << sym.name << "\t";
 
     switch(sym.defined){
 
       case true:
         this->outputFile << "DEF\n";
-        outputLinkerStream << "DEF\n";
         break;
 
       case false:
         this->outputFile << "UND\n";
-        outputLinkerStream << "UND\n";
         break;
     }
   }
 
   this->outputFile << endl;
-  outputLinkerStream << endl;
 
-  outputLinkerStream << "RELOCATIONS\nUND\n";
-  for(Section sec: sectionTable){
+  for(const Section& sec: sectionTable){
     this->outputFile << "Relocation table <" << sec.name << ">\n";
     this->outputFile << "Offset\tType\tSymbol ID\tAddend\n";
 
-    for(vector<Relocation> rel: relocationTable){
+    for(const vector<Relocation>& rel: relocationTable){
       if(rel.size() == 0) continue;
       if(rel.at(0).sectionId != sec.id){
         continue;
       }
 
-      outputLinkerStream << sectionTable.at(rel.at(0).sectionId).name << endl;
-      for(Relocation relocations: rel){
+      for(const Relocation& relocations: rel){
         this->outputFile << std::uppercase << std::setfill('0') << std::setw(4) << std::hex << relocations.offset << std::dec << "\t";
-        outputLinkerStream << std::uppercase << std::setfill('0') << std::setw(4) << std::hex << relocations.offset << std::dec << "\t";
 
         switch(relocations.type){
           case R_16:
             this->outputFile << "R_16\t";
-            outputLinkerStream << "R_16\t";
             break;
           case R_PC16:
             this->outputFile << "R_PC16\t";
-            outputLinkerStream << "R_PC16\t";
             break;
           case R_WORD16:
             this->outputFile << "R_WORD16\t";
-            outputLinkerStream << "R_WORD16\t";
             break;
         }
         this->outputFile << relocations.symbolId << "\t";
-        outputLinkerStream << relocations.symbolId << "\t";
 
         if(relocations.addend >= 0){
           this->outputFile << std::setfill('0') << ::setw(4) << std::hex << relocations.addend << std::dec <<"\n";
-          outputLinkerStream << std::setfill('0') << ::setw(4) << std::hex << relocations.addend << std::dec <<"\n";
         } else {
-          string help = to_string(relocations.addend);
-          vector<string> help1 = decToCode(help);
-          for(string s: help1){
-            this->outputFile << s;
-            outputLinkerStream << s;
-          }
+          writeHexByte(this->outputFile, (relocations.addend >> 8) & 0xFF);
+          writeHexByte(this->outputFile, relocations.addend & 0xFF);
           this->outputFile << endl;
-          outputLinkerStream << endl;
         }
       }
 
     }
     this->outputFile << endl;
-    outputLinkerStream << endl;
   }
 
   this->outputFile << endl;
-  outputLinkerStream << endl;
 
-  outputLinkerStream << "MACHINE CODE\n";
-  for(Section sec: sectionTable){
+  for(size_t k = 0; k < sectionTable.size(); k++){
+    const Section& sec = sectionTable.at(k);
     this->outputFile << "Machine code <" << sec.name << ">\n";
-    outputLinkerStream << sec.name << "\n";
 
-    for(vector<MachineCode> mcodes: machineCode){
-      if(mcodes.at(0).sectionName != sec.name || sec.name == "UND" || mcodes.size() == 0){
-        continue;
-      }
+    const vector<uint8_t>& code = machineCode.at(k);
+    for(size_t i = 0; i < code.size(); i++){
 
-      int i = 0;
-      for(MachineCode mcode: mcodes){
-
-        if(i % 8 == 0){
-          this->outputFile << endl << std::setfill('0') << std::setw(4) << std::hex << i << std::dec << ": ";
-        }
-
-        this->outputFile << mcode.value << " ";
-        outputLinkerStream << mcode.value << " ";
-        i++;
+      if(i % 8 == 0){
+        this->outputFile << endl << std::setfill('0') << std::setw(4) << std::hex << i << std::dec << ": ";
       }
 
+      writeHexByte(this->outputFile, code[i]);
+      this->outputFile << " ";
     }
     this->outputFile << endl;
-    outputLinkerStream << endl;
   }
 
   this->outputFile << endl;
-  outputLinkerStream << endl << "END";
 
-  for(Symbol symb: symbolTable){
+  for(const Symbol& symb: symbolTable){
     this->outputFile << "Forward table <" << symb.name << ">\n";
     this->outputFile << "Forwarding_type\tSection ID\tOffset\tOffset Relocation\n" ;
 
-    for(Forwarding fw: symb.forwardingTable){
+    for(const Forwarding& fw: symb.forwardingTable){
       switch(fw.type){
         case TEXT:
           this->outputFile << "TEXT\t";
@@ -368,11 +244,61 @@ void Assembler::printOutput(){
 
 }
 
-void Assembler::backPatchingRelocation(Symbol sym){
-  int j = 0;
-  for(vector<Relocation> relTable: relocationTable){
-    int i = 0;
-    for(Relocation rel: relTable){
+/**
+ * @brief writes binary object for linker to linker.<name>.o
+ * 
+ * @return true object is written
+ * @return false object file couldn't be written
+ */
+bool Assembler::writeObjectFile(){
+
+  ObjectFile object;
+
+  for(size_t k = 0; k < sectionTable.size(); k++){
+    const Section& sec = sectionTable.at(k);
+
+    ObjectSection osec;
+    osec.name = object.addString(sec.name);
+    osec.size = machineCode.at(k).size();
+    osec.codeOffset = object.code.size();
+    osec.relocationStart = object.relocations.size();
+    object.code.insert(object.code.end(), machineCode.at(k).begin(), machineCode.at(k).end());
+
+    for(const vector<Relocation>& rel: relocationTable){
+      if(rel.size() == 0 || rel.at(0).sectionId != sec.id) continue;
+
+      for(const Relocation& relocation: rel){
+        ObjectRelocation orel = {};
+        orel.offset = relocation.offset;
+        orel.symbolId = relocation.symbolId;
+        orel.addend = relocation.addend;
+        orel.type = relocation.type;
+        object.relocations.push_back(orel);
+      }
+    }
+    osec.relocationCount = object.relocations.size() - osec.relocationStart;
+    object.sections.push_back(osec);
+  }
+
+  for(const Symbol& sym: symbolTable){
+    ObjectSymbol osym = {};
+    osym.name = object.addString(sym.name);
+    osym.id = sym.id;
+    osym.offset = sym.offset;
+    osym.sectionId = sym.sectionId == 0 ? OBJECT_UND_SECTION : sym.sectionId;
+    osym.type = sym.type;
+    osym.bind = sym.bind;
+    osym.defined = sym.defined;
+    object.symbols.push_back(osym);
+  }
+
+  size_t lastindex = outputFileString.find_last_of(".");
+  return object.write("linker." + outputFileString.substr(0, lastindex) + ".o");
+}
+
+void Assembler::backPatchingRelocation(const Symbol& sym){
+  for(vector<Relocation>& relTable: relocationTable){
+    for(Relocation& rel: relTable){
       if(rel.symbolId == sym.id){
         if(sym.bind == GLOBAL){
           rel.addend = 0;
@@ -380,1653 +306,734 @@ void Assembler::backPatchingRelocation(Symbol sym){
           rel.addend = sym.offset;
           rel.symbolId = sym.sectionId;
         }
-        relTable.at(i) = rel;
       }
-      i++;
     }
-    relocationTable.at(j) = relTable;
-    j++;
   }
 }
 
-/**
- * @brief One and only pass of assembler
- * 
- * @return int 0 - it is good, -1 - syntax error, -2 - some labels or code are not in section
- */
-int Assembler::pass(){
-
-  if(!openFiles()){
-    return -3;
-  }
-  setGoodLines();
-
-  size_t lastindex = outputFileString.find_last_of(".");
-  string outputFileHelpString = outputFileString.substr(0, lastindex) + "Helper.o";
-  ofstream outputHelp;
-  outputHelp.open(outputFileHelpString, ios::out|ios::trunc);
+static bool isLetter(char c){
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
 
-  int locationCounter = 0;
-  int locationCounterGlobal = 0;
-  int globalBase = 0;
-  Section currentSection;
-  currentSection.name = "";
+static bool isDigit(char c){
+  return c >= '0' && c <= '9';
+}
 
-  int currentSectionId = -1;
-  vector<MachineCode> currentSectionMachineCode;
-  vector<Relocation> currentRelocationTable;
+static bool isHexDigit(char c){
+  return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
 
-  for(string s: goodLines){
-    smatch m;
-    bool err = true;
+static bool isSymbolChar(char c){
+  return isLetter(c) || isDigit(c) || c == '_';
+}
 
-    // line is emtpy
-    if(s == ""){
-      outputHelp << "Skipped line" << endl;
-      continue;
-    }
+static bool isRegister(const string& name){
+  if(name == "sp" || name == "psw") return true;
+  return name.size() == 2 && name[0] == 'r' && name[1] >= '0' && name[1] <= '7';
+}
 
-    // find label
-    if(regex_search(s, m, labelRegex)){
+/**
+ * @brief returns number that register has in machine code
+ *
+ * @param reg register name
+ * @return uint8_t 0 - 7 for r0 - r7, 6 for sp and 8 for psw
+ */
+static uint8_t registerCode(const string& reg){
+  if(reg == "sp") return 6;
+  if(reg == "psw") return 8;
+  return reg[1] - '0';
+}
 
-      outputHelp << "Found label: " << m.str(0) << endl;
-      
-      smatch m1;
-      string s1 = m.str(0);
-      regex_search(s1, m1, symbolRegex);
-      string labelName = m1.str(0);
-      outputHelp << "Label name: " << labelName << endl;      // we take label name and check if symbol exists, is it duplcate...
-      s = m.suffix().str();                                   // remove label from the string
-
-      if(m.prefix().str() != ""){
-        return -1;
-      }
+/**
+ * @brief returns value of decimal or hex literal, only lower 16 bits end up in machine code
+ *
+ * @param literal literal token
+ */
+static int literalValue(const string& literal){
+  if(literal.compare(0, 2, "0x") == 0){
+    return stoul(literal.substr(2), nullptr, 16) & 0xFFFF;
+  }
+  return stoi(literal);
+}
 
-      if(currentSectionId == -1){
-        return -2;
-      }
+/**
+ * @brief splits line into tokens, whitespace is skipped and comment ends the line
+ *
+ * @param line line from the input file
+ * @return true if every character of the line belongs to a token
+ * @return false if some character can't start a token, syntax error
+ */
+bool Assembler::tokenize(const string& line){
 
-      bool found = false;
-      int i = 0;
-      for(Symbol sym: symbolTable){
-        if(sym.name == labelName){
-          if(sym.defined){
-            return -1;
-          }
-
-          sym.defined = true;
-          sym.value = 0;
-          sym.offset = locationCounter;
-          sym.sectionId = currentSectionId;
-          found = true;
-          if(sym.bind == NOBIND) sym.bind = LOCAL;
-
-          symbolTable.at(i) = sym;
-
-          int j = 0;
-          for(Relocation rel: currentRelocationTable){
-            if(rel.symbolId == sym.id && rel.type == R_PC16){
-              rel.type = R_16;
-              currentRelocationTable.at(j) = rel;
-              break;
-            }
-            j++;
-          }
-
-          currentSectionMachineCode = backPatching(sym, currentSection.id, locationCounter, currentSectionMachineCode);
-          backPatchingRelocation(sym);
+  tokens.clear();
+  tokenPosition = 0;
 
-          break;
-        }
+  size_t i = 0;
+  size_t n = line.size();
+  while(i < n){
+    char c = line[i];
+    if(c == ' ' || c == '\t' || c == '\r'){
+      i++;
+      continue;
+    }
+    if(c == '#') break;
+
+    Token token;
+    size_t start = i;
+    if(isLetter(c)){
+      while(i < n && isSymbolChar(line[i])) i++;
+      token.type = SYMBOL_TOKEN;
+    } else if(c == '.' && i + 1 < n && isLetter(line[i + 1])){
+      i++;
+      while(i < n && isLetter(line[i])) i++;
+      token.type = DIRECTIVE_TOKEN;
+    } else if(isDigit(c) || (c == '-' && i + 1 < n && isDigit(line[i + 1]))){
+      if(c == '0' && i + 1 < n && line[i + 1] == 'x'){
+        i += 2;
+        if(i == n || !isHexDigit(line[i])) return false;
+        while(i < n && isHexDigit(line[i])) i++;
+      } else {
         i++;
+        while(i < n && isDigit(line[i])) i++;
       }
-
-      if(!found){
-        Symbol sym;
-        sym.name = labelName;
-        sym.value = 0;
-        sym.defined = true;
-        sym.bind = LOCAL;
-        sym.offset = locationCounter;
-        sym.type = NOTYP;
-        sym.id = symbolId++;
-        sym.sectionId = currentSectionId;
-        symbolTable.push_back(sym);
+      if(i < n && isSymbolChar(line[i])) return false;
+      token.type = LITERAL_TOKEN;
+    } else {
+      switch(c){
+        case ',': token.type = COMMA_TOKEN; break;
+        case ':': token.type = COLON_TOKEN; break;
+        case '$': token.type = DOLLAR_TOKEN; break;
+        case '%': token.type = PERCENT_TOKEN; break;
+        case '*': token.type = STAR_TOKEN; break;
+        case '[': token.type = LBRACKET_TOKEN; break;
+        case ']': token.type = RBRACKET_TOKEN; break;
+        case '+': token.type = PLUS_TOKEN; break;
+        default: return false;
       }
-
-      outputHelp << "What is left after removing label: " << s << endl;
-
+      i++;
     }
 
-    // global directive
-    if(regex_search(s, m, globalRegex)){
-      outputHelp << "Found global directive: " << m.str(0) << endl;
+    token.text = line.substr(start, i - start);
+    tokens.push_back(token);
+  }
 
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
+  Token end;
+  end.type = END_TOKEN;
+  tokens.push_back(end);
+  return true;
+}
 
-      smatch m1;
-      string s1 = m.str(0);
-      regex_search(s1, m1, symbolRegex);              // remove global from symbols
-      s1 = m1.suffix().str();
-
-      while(regex_search(s1, m1, symbolRegex)){
-        outputHelp << "Symbol name: " << m1.str(0) << endl;
-        string symbolName = m1.str(0);
-        s1 = m1.suffix().str();
-
-        bool found = false;
-        int i = 0;
-        for(Symbol sym: symbolTable){
-          if(sym.name == symbolName){
-            sym.bind = GLOBAL;
-            symbolTable.at(i) = sym;
-            found = true;
-            break;
-          }
-          i++;
-        }
+/**
+ * @brief looks at token without consuming it, END_TOKEN is returned past the end of line
+ *
+ * @param ahead how many tokens after current one
+ */
+const Assembler::Token& Assembler::peek(size_t ahead){
+  if(tokenPosition + ahead >= tokens.size()) return tokens.back();
+  return tokens[tokenPosition + ahead];
+}
 
-        if(!found){
-          Symbol sym;
-          sym.name = symbolName;
-          sym.defined = false;
-          sym.size = 0;
-          sym.value = 0;
-          sym.type = NOTYP;
-          sym.bind = GLOBAL;
-          sym.offset = locationCounter;
-          sym.id = symbolId++;
-          symbolTable.push_back(sym);
-        }
-      }
-      s = m.suffix().str();
-      
-    }
+/**
+ * @brief consumes current token if it is of given type
+ *
+ * @return true if token was consumed
+ */
+bool Assembler::accept(TokenType type){
+  if(peek().type != type || type == END_TOKEN) return false;
+  tokenPosition++;
+  return true;
+}
 
-    // extern directive
-    if(regex_search(s, m, externRegex)){
-      outputHelp << "Found extern directive: " << m.str(0) << endl;
+/**
+ * @brief consumes symbol that isn't register name
+ *
+ * @param name where symbol name is stored
+ * @return true if symbol was consumed
+ */
+bool Assembler::expectSymbol(string& name){
+  if(peek().type != SYMBOL_TOKEN || isRegister(peek().text)) return false;
+  name = tokens[tokenPosition++].text;
+  return true;
+}
 
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
+/**
+ * @brief consumes register name
+ *
+ * @param reg where register name is stored
+ * @return true if register was consumed
+ */
+bool Assembler::expectRegister(string& reg){
+  if(peek().type != SYMBOL_TOKEN || !isRegister(peek().text)) return false;
+  reg = tokens[tokenPosition++].text;
+  return true;
+}
 
-      smatch m1;
-      string s1 = m.str(0);
-      regex_search(s1, m1, symbolRegex);              // remove extern from symbols
-      s1 = m1.suffix().str();
-
-      while(regex_search(s1, m1, symbolRegex)){
-        outputHelp << "Symbol name: " << m1.str(0) << endl;
-        string symbolName = m1.str(0);
-        s1 = m1.suffix().str();
-
-        bool found = false;
-        int i = 0;
-        for(Symbol sym: symbolTable){
-          if(sym.name == symbolName){
-            sym.bind = GLOBAL;
-            symbolTable.at(i) = sym;
-            found = true;
-            break;
-          }
-          i++;
-        }
+/**
+ * @brief parses operand of jump (jump = true) or of ldr/str instruction
+ *
+ * jumps: lit, sym, %sym, *lit, *sym, *reg, *[reg], *[reg + lit], *[reg + sym]
+ * data:  $lit, $sym, %sym, lit, sym, reg, [reg], [reg + lit], [reg + sym]
+ *
+ * @param jump if it is operand of jump instruction
+ * @param op parsed operand
+ * @return true if operand is good
+ */
+bool Assembler::parseOperand(bool jump, Operand& op){
 
-        if(!found){
-          Symbol sym;
-          sym.name = symbolName;
-          sym.defined = false;
-          sym.size = 0;
-          sym.value = 0;
-          sym.type = NOTYP;
-          sym.bind = GLOBAL;
-          sym.offset = locationCounter;
-          sym.id = symbolId++;
-          symbolTable.push_back(sym);
-        }
-      }
-      s = m.suffix().str();
-    }
+  if(accept(PERCENT_TOKEN)){
+    op.type = SYM_PCREL;
+    return expectSymbol(op.symbol);
+  }
 
-    // section directive
-    if(regex_search(s, m, sectionRegex)){
-      outputHelp << "Found section directive: " << m.str(0) << endl;
+  bool value = jump ? !accept(STAR_TOKEN) : accept(DOLLAR_TOKEN);
+  if(!value){
+    return parseLocation(op);
+  }
 
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
+  if(peek().type == LITERAL_TOKEN){
+    op.type = LIT_VALUE;
+    op.literal = tokens[tokenPosition++].text;
+    return true;
+  }
+  op.type = SYM_VALUE;
+  return expectSymbol(op.symbol);
+}
 
-      smatch m1;
-      string s1 = m.str(0);
-      regex_search(s1, m1, symbolRegex);              // remove section from symbols
-      s1 = m1.suffix().str();
+/**
+ * @brief parses operand that is register or memory location: lit, sym, reg, [reg], [reg + lit], [reg + sym]
+ *
+ * @param op parsed operand
+ * @return true if operand is good
+ */
+bool Assembler::parseLocation(Operand& op){
 
-      outputHelp << "Section name: " << s1 << endl;
+  if(peek().type == LITERAL_TOKEN){
+    op.type = LIT_MEM;
+    op.literal = tokens[tokenPosition++].text;
+    return true;
+  }
 
-      Section section;
-      section.id = sectionId++;
-      section.name = s1;
-      section.base = locationCounterGlobal;
+  if(expectRegister(op.reg)){
+    op.type = REG_DIR;
+    return true;
+  }
 
-      if(currentSection.name == ""){
-        currentSection = section;
-      } else {
-        currentSection.length = locationCounter;
-        sectionTable.push_back(currentSection);
-        currentSection = section;
-        locationCounter = 0;
-        this->machineCode.push_back(currentSectionMachineCode);
-        this->relocationTable.push_back(currentRelocationTable);
-        currentSectionMachineCode.clear();
-        currentRelocationTable.clear();
-      }
+  if(!accept(LBRACKET_TOKEN)){
+    op.type = SYM_MEM;
+    return expectSymbol(op.symbol);
+  }
 
-      bool found = false;
-      for(Symbol sym: symbolTable){
-        if(sym.name == s1){
-          return -1;            // mislim da ne moze da postoje vise sekcija sa isitm imenom ili labela i sekcija sa istim imenom
-        }
-      }
+  if(!expectRegister(op.reg)) return false;
 
-      if(!found){
-        Symbol sym;
-        sym.name = s1;
-        sym.defined = false;
-        sym.size = 0;
-        sym.value = 0;
-        sym.type = SCTN;
-        sym.bind = NOBIND;
-        currentSectionId = sym.sectionId = sym.id = symbolId++;
-        sym.offset = locationCounter;
-        symbolTable.push_back(sym);
-      }
-      s = m.suffix().str();
+  if(accept(PLUS_TOKEN)){
+    if(peek().type == LITERAL_TOKEN){
+      op.type = REG_IND_LIT;
+      op.literal = tokens[tokenPosition++].text;
+    } else {
+      op.type = REG_IND_SYM;
+      if(!expectSymbol(op.symbol)) return false;
     }
+  } else {
+    op.type = REG_IND;
+  }
 
-    // word directive
-    if(regex_search(s, m, wordRegex)){
-      outputHelp << "Found word directive: " << m.str(0) << endl;
-
-      if(currentSectionId == -1){
-        return -2;
-      }
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
+  return accept(RBRACKET_TOKEN);
+}
 
-      smatch m1;
-      string s1 = m.str(0);
-      s = m.suffix().str();
-      regex_search(s1, m1, symbolRegex);              // remove word from symbols
-      s1 = m1.suffix().str();
-
-      int cnt = 0;
-      while(regex_search(s1, m1, symbolOrLiteralRegex)){
-        locationCounter += 2;
-        locationCounterGlobal += 2;
-        outputHelp << "Symbol or Literal val: " << m1.str(0) << endl;
-        string val = m1.str(0);
-        s1 = m1.suffix().str();
-
-        bool symbolFound = false;
-        if(regex_search(val, m1, symbolOnlyRegex))
-          symbolFound = true;
-
-        if(regex_search(val, m1, literalRegex) && !symbolFound){  //
-
-          if(regex_search(val, m1, hexRegex)){
-            string num2 = m1.str(0);
-            regex_search(num2, m1, hexRemoveRegex);
-            num2 = m1.suffix().str();
-            vector<string> help = hexToCode(num2);
-            currentSectionMachineCode = addToCode(help[1], currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode(help[0], currentSection.name, currentSectionMachineCode);
-
-          } else {
-            string num2 = val;
-            vector<string> help = decToCode(num2);
-            currentSectionMachineCode = addToCode(help[1], currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode(help[0], currentSection.name, currentSectionMachineCode);
-          }
+/**
+ * @brief adds global or extern symbol to symbol table, or marks existing one as global
+ *
+ * @param symbolName symbol's name
+ */
+void Assembler::declareGlobal(const string& symbolName){
 
-        } else {
-          if(regex_search(val, m1, symbolOnlyRegex)){       // add to forward if needed
-            currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-            string symName = m1.str(0);
-            int ret = searchSymbol(symName);
-            int endSize = currentSectionMachineCode.size() - 1;
-            int startSize = currentSectionMachineCode.size() - 2;
-            int size = currentRelocationTable.size();
-            currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-            currentRelocationTable, 2, startSize, endSize);
-
-            if(size == currentRelocationTable.size() && ret != -1){
-              int mov = locationCounter - symbolTable.at(ret).offset - 1;
-              string mov1 = to_string(mov);
-              vector<string> help = decToCode(mov1);
-              bool done = false;
-              for(string s: help){
-                if(!done){
-                  currentSectionMachineCode.at(startSize).value = s;
-                  done = true;
-                } else {
-                  currentSectionMachineCode.at(endSize).value = s;
-                }
-              }
-            }
-
-          }
-        } 
-
-      }  
-    }
+  outputHelp << "Symbol name: " << symbolName << endl;
 
-    // wordOnly directive
-    if(regex_search(s, m, wordOnlyRegex)){
-      outputHelp << "Found word directive: " << m.str(0) << endl;
+  int i = searchSymbol(symbolName);
+  if(i != -1){
+    symbolTable.at(i).bind = GLOBAL;
+  } else {
+    Symbol sym;
+    sym.name = symbolName;
+    sym.defined = false;
+    sym.size = 0;
+    sym.value = 0;
+    sym.type = NOTYP;
+    sym.bind = GLOBAL;
+    sym.offset = locationCounter;
+    sym.sectionId = 0;
+    sym.id = symbolId++;
+    addSymbol(sym);
+  }
+}
 
-      if(currentSectionId == -1){
-        return -2;
-      }
-      if(m.prefix().str() != ""){
-        return -1;
-      }
+/**
+ * @brief adds two bytes of literal to machine code
+ *
+ * @param literal decimal or hex literal
+ * @param littleEndian lower byte first (.word) or higher byte first (instructions)
+ */
+void Assembler::addLiteralToCode(const string& literal, bool littleEndian){
 
-      smatch m1;
-      s = m.suffix().str();
-
-      int cnt = 0;
-      while(regex_search(s, m1, symbolOrLiteralRegex)){
-        locationCounter += 2;
-        locationCounterGlobal += 2;
-        outputHelp << "Symbol or Literal val: " << m1.str(0) << endl;
-        string val = m1.str(0);
-        s = m1.suffix().str();
-
-        bool symbolFound = false;
-        if(regex_search(val, m1, symbolOnlyRegex))
-          symbolFound = true;
-
-        if(regex_search(val, m1, literalRegex)){  //
-
-          if(regex_search(val, m1, hexRegex)){
-            string num2 = m1.str(0);
-            regex_search(num2, m1, hexRemoveRegex);
-            num2 = m1.suffix().str();
-            vector<string> help = hexToCode(num2);
-            currentSectionMachineCode = addToCode(help[1], currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode(help[0], currentSection.name, currentSectionMachineCode);
-
-          } else {
-            string num2 = val;
-            vector<string> help = decToCode(num2);
-            currentSectionMachineCode = addToCode(help[1], currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode(help[0], currentSection.name, currentSectionMachineCode);
-          }
+  int value = literalValue(literal);
+  if(littleEndian){
+    addToCode(value & 0xFF, currentSectionMachineCode);
+    addToCode((value >> 8) & 0xFF, currentSectionMachineCode);
+  } else {
+    addToCode((value >> 8) & 0xFF, currentSectionMachineCode);
+    addToCode(value & 0xFF, currentSectionMachineCode);
+  }
+}
 
-        } else {
-          if(regex_search(val, m1, symbolOnlyRegex)){       // add to forward if needed
-            currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-            string symName = m1.str(0);
-            int ret = searchSymbol(symName);
-            int endSize = currentSectionMachineCode.size() - 1;
-            int startSize = currentSectionMachineCode.size() - 2;
-            int size = currentRelocationTable.size();
-            currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-            currentRelocationTable, 2, startSize, endSize);
-
-            if(size == currentRelocationTable.size() && ret != -1){
-              int mov = locationCounter - symbolTable.at(ret).offset - 1;
-              string mov1 = to_string(mov);
-              vector<string> help = decToCode(mov1);
-              bool done = false;
-              for(string s: help){
-                if(!done){
-                  currentSectionMachineCode.at(startSize).value = s;
-                  done = true;
-                } else {
-                  currentSectionMachineCode.at(endSize).value = s;
-                }
-              }
-            }
-
-          }
-        }
+/**
+ * @brief adds two bytes for symbol value to machine code, and relocation or forward element if needed
+ *
+ * location counter has to point after the instruction or word already
+ *
+ * @param symName symbol's name
+ * @param pc 0 - R_PC16, 1 - R_16, 2 - R_WORD16
+ */
+void Assembler::addSymbolToCode(const string& symName, int pc){
 
-      }  
-    }
+  outputHelp << "Symbol found: " << symName << endl;
 
-    // skip directive
-    if(regex_search(s, m, skipRegex)){
-      outputHelp << "Found skip directive: " << m.str(0) << endl;
-      s = m.suffix().str();
+  addToCode(0x00, currentSectionMachineCode);
+  addToCode(0x00, currentSectionMachineCode);
 
-      if(currentSectionId == -1){
-        return -2;
-      }
-      if(m.prefix().str() != ""){
-        return -1;
-      }
+  int ret = searchSymbol(symName);
+  int endSize = currentSectionMachineCode.size() - 1;
+  int startSize = currentSectionMachineCode.size() - 2;
+  size_t size = currentRelocationTable.size();
+  addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection,
+  currentRelocationTable, pc, startSize, endSize);
 
-      smatch m1;
-      regex_search(s, m1, literalRegex);              
-      string literal = m1.str(0);
-      s = m1.suffix().str();
-      outputHelp << "Literal: " << literal << endl;      
-
-      int num = stoi(literal);
-      locationCounter += num;
-      locationCounterGlobal += num;
-      for(int i = 0; i < num; i++){
-         currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-      }
+  if(size == currentRelocationTable.size() && ret != -1){
+    int mov = locationCounter - symbolTable.at(ret).offset - 1;
+    currentSectionMachineCode.at(startSize) = (mov >> 8) & 0xFF;
+    currentSectionMachineCode.at(endSize) = mov & 0xFF;
+  }
+}
 
-      if(s != "") return -1;
+/**
+ * @brief adds operand bytes of jump or ldr/str instruction to machine code, opcode byte is already added
+ *
+ * @param first higher 4 bits of registers byte, 0xF for jumps and destination register for ldr/str
+ * @param op operand
+ * @param jump if it is jump instruction
+ */
+void Assembler::addOperandToCode(uint8_t first, const Operand& op, bool jump){
 
-    }
+  switch(op.type){
 
-    // end directive
-    if(regex_search(s, m, endRegex)){
-      outputHelp << "Found end directive: " << m.str(0) << endl;
+    case REG_DIR:
+    case REG_IND:
+      outputHelp << "Register found: " << op.reg << endl;
+      locationCounter += 3;
+      locationCounterGlobal += 3;
+      addToCode(first << 4 | registerCode(op.reg), currentSectionMachineCode);
+      addToCode(op.type == REG_DIR ? 0x01 : 0x02, currentSectionMachineCode);
       break;
-    }
-
-    // no operand isntruction
-    if(regex_search(s, m, noOperandsInstructions)){
-      outputHelp << "Found instruction with no operands: " << m.str(0) << endl;
 
-      if(currentSectionId == -1){
-        return -2;
-      }
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
-
-      string instruction = m.str(0);
-      s = m.suffix().str();    
-
-      if(instruction == "halt"){
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
+    case REG_IND_LIT:
+    case REG_IND_SYM:
+      outputHelp << "Register found: " << op.reg << endl;
+      locationCounter += 5;
+      locationCounterGlobal += 5;
+      addToCode(first << 4 | registerCode(op.reg), currentSectionMachineCode);
+      addToCode(0x03, currentSectionMachineCode);
+      if(op.type == REG_IND_LIT){
+        addLiteralToCode(op.literal, false);
       } else {
-        if(instruction == "iret"){
-          currentSectionMachineCode = addToCode("20", currentSection.name, currentSectionMachineCode);
-        } else {
-          if(instruction == "ret"){
-            currentSectionMachineCode = addToCode("40", currentSection.name, currentSectionMachineCode);
-          }
-        }
+        addSymbolToCode(op.symbol, 1);
       }
-      
-      locationCounter++;
-      locationCounterGlobal++;
-    }
-
-    // one register instruction
-    if(regex_search(s, m, oneRegisterInsturctions)){
-      outputHelp << "Found instruction with one register as operand: " << m.str(0) << endl;
-      string helper = s;
-      s = m.suffix().str();
-      if(currentSectionId == -1){
-        return -2;
-      }
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
-
-      smatch m1;
-      regex_search(helper, m1, symbolOnlyRegex);
-      string instruction = m1.str(0);
-
-      outputHelp << "Insturction: " << instruction << endl;
+      break;
 
-      regex_search(helper, m1, registersRegex);
-      outputHelp << "Register found: " << m1.str(0) << endl;
-      string reg = m1.str(0);
-      
-      if(instruction == "push" || instruction == "pop"){
-
-        if(instruction == "push"){
-          currentSectionMachineCode = addToCode("B0", currentSection.name, currentSectionMachineCode);
-
-          if(reg == "sp"){
-            currentSectionMachineCode = addToCode("66", currentSection.name, currentSectionMachineCode);
-          } else {
-            if(reg == "psw"){
-              currentSectionMachineCode = addToCode("86", currentSection.name, currentSectionMachineCode);
-            } else {
-              regex_search(reg, m1, literalRegex);
-              string num = m1.str(0);
-              currentSectionMachineCode = addToCode(num +"6", currentSection.name, currentSectionMachineCode);              
-            }
-          }
-
-           currentSectionMachineCode = addToCode("12", currentSection.name, currentSectionMachineCode);
-
-        } else {  // instruction is pop
-           currentSectionMachineCode = addToCode("A0", currentSection.name, currentSectionMachineCode);
-
-          if(reg == "sp"){
-             currentSectionMachineCode = addToCode("66", currentSection.name, currentSectionMachineCode);
-          } else {
-            if(reg == "psw"){
-               currentSectionMachineCode = addToCode("86", currentSection.name, currentSectionMachineCode);
-            } else {
-              regex_search(reg, m1, literalRegex);
-              string num = m1.str(0);
-              currentSectionMachineCode = addToCode(num +"6", currentSection.name, currentSectionMachineCode);              
-            }
-          }
-          currentSectionMachineCode = addToCode("42", currentSection.name, currentSectionMachineCode);
-        }
+    case LIT_VALUE:
+    case LIT_MEM:
+      outputHelp << "Literal found: " << op.literal << endl;
+      locationCounter += 5;
+      locationCounterGlobal += 5;
+      addToCode(first << 4, currentSectionMachineCode);
+      addToCode(op.type == LIT_VALUE ? 0x00 : 0x04, currentSectionMachineCode);
+      addLiteralToCode(op.literal, false);
+      break;
 
-        locationCounter+=3;
-        locationCounterGlobal+=3;
+    case SYM_VALUE:
+    case SYM_MEM:
+      locationCounter += 5;
+      locationCounterGlobal += 5;
+      addToCode(first << 4, currentSectionMachineCode);
+      addToCode(op.type == SYM_VALUE ? 0x00 : 0x04, currentSectionMachineCode);
+      if(op.type == SYM_MEM && jump){
+        // TODO
+        addToCode(0x00, currentSectionMachineCode);
+        addToCode(0x00, currentSectionMachineCode);
       } else {
-        if (instruction == "int" || instruction == "not"){
-
-          if(instruction == "int"){
-            currentSectionMachineCode = addToCode("10", currentSection.name, currentSectionMachineCode);
-            if(reg == "sp"){
-              currentSectionMachineCode = addToCode("6F", currentSection.name, currentSectionMachineCode);
-            } else {
-              if(reg == "psw"){
-                currentSectionMachineCode = addToCode("8F", currentSection.name, currentSectionMachineCode);
-              } else {
-                regex_search(reg, m1, literalRegex);
-                string num = m1.str(0);                
-                currentSectionMachineCode = addToCode(num + "F", currentSection.name, currentSectionMachineCode);              
-              }
-            }
-          } else {  // instruction is not
-            currentSectionMachineCode = addToCode("80", currentSection.name, currentSectionMachineCode);
-
-            if(reg == "sp"){
-              currentSectionMachineCode = addToCode("66", currentSection.name, currentSectionMachineCode);
-            } else {
-              if(reg == "psw"){
-                currentSectionMachineCode = addToCode("88", currentSection.name, currentSectionMachineCode);
-              } else {
-                regex_search(reg, m1, literalRegex);
-                string num = m1.str(0) + m1.str(0);
-                currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);              
-              }
-            }
-          }
-
-          locationCounter+=2;
-          locationCounterGlobal+=2;          
-        }
-      }
-      
-    }
-
-    if(regex_search(s, m, twoRegistersInstructions)){
-      outputHelp << "Found instruction with two registers as operands: " << m.str(0) << endl;
-      if(currentSectionId == -1){
-        return -2;
+        addSymbolToCode(op.symbol, 1);
       }
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
-
-      smatch m1;
-      string s1 = m.str(0);
-      string helper = s;
-      s = m.suffix().str();
-      regex_search(s1, m1, symbolOnlyRegex);                // remove instruction name
-      string instruction = m1.str(0);
-      s1 = m1.suffix().str();
-
-      regex_search(instruction, m1, symbolOnlyRegex);                // remove instruction name
-      instruction = m1.str(0);
-
-      outputHelp << "Instruction: " << instruction << endl;
-
-      regex_search(helper, m1, registersRegex);
-      string r1 = m1.str(0);
-      outputHelp << "Register found: " << m1.str(0) << endl;
-      helper = m1.suffix().str();
-
-      regex_search(helper, m1, registersRegex);
-      string r2 = m1.str(0);
-      outputHelp << "Register found: " << m1.str(0) << endl;
-
-      string num;
-      if(r1 == "sp") num = "6";
-      else if(r1 == "psw") num = "8";
-        else {
-          if(regex_search(r1, m1, literalRegex))
-            num = m1.str(0);
-        }
-      
-      if(r2 == "sp") num += "6";
-      else if(r2 == "psw") num += "8";
-        else {
-          if(regex_search(r2, m1, literalRegex))
-            num += m1.str(0);
-        }
+      break;
 
-      if(instruction == "xchg"){
-        currentSectionMachineCode = addToCode("60", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
+    case SYM_PCREL:
+      locationCounter += 5;
+      locationCounterGlobal += 5;
+      addToCode(first << 4 | (jump ? 7 : 0), currentSectionMachineCode);
+      addToCode(0x05, currentSectionMachineCode);
+      addSymbolToCode(op.symbol, 0);
+      break;
+  }
+}
 
-      }
-      else {  
-        if(instruction == "add"){
-          currentSectionMachineCode = addToCode("70", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
+/**
+ * @brief defines label, label is current token and it is followed by colon
+ *
+ * @return int 0 - it is good, -1 - label is already defined, -2 - label is not in section
+ */
+int Assembler::parseLabel(){
 
-        }
-        else {
-          if(instruction == "sub"){
-            currentSectionMachineCode = addToCode("71", currentSection.name, currentSectionMachineCode);
-            currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-          }
-          else {
-            if(instruction == "mul"){
-              currentSectionMachineCode = addToCode("72", currentSection.name, currentSectionMachineCode);  
-              currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-            } 
-            else {
-              if(instruction == "div"){
-                currentSectionMachineCode = addToCode("73", currentSection.name, currentSectionMachineCode);              
-                currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-              } 
-              else {
-                if(instruction == "cmp"){
-                  currentSectionMachineCode = addToCode("74", currentSection.name, currentSectionMachineCode);
-                  currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                }
-                else {
-                  if(instruction == "and"){
-                    currentSectionMachineCode = addToCode("81", currentSection.name, currentSectionMachineCode);
-                    currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                  }
-                  else {
-                    if(instruction == "or"){
-                      currentSectionMachineCode = addToCode("82", currentSection.name, currentSectionMachineCode);
-                      currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                    }
-                    else {
-                      if(instruction == "xor"){
-                        currentSectionMachineCode = addToCode("83", currentSection.name, currentSectionMachineCode);                      
-                        currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                      }
-                      else {
-                        if(instruction == "test"){
-                          currentSectionMachineCode = addToCode("84", currentSection.name, currentSectionMachineCode);                       
-                          currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                        }
-                        else {
-                          if(instruction == "shl"){
-                            currentSectionMachineCode = addToCode("90", currentSection.name, currentSectionMachineCode);
-                            currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                          }
-                          else {
-                            if(instruction == "shr"){
-                              currentSectionMachineCode = addToCode("91", currentSection.name, currentSectionMachineCode);
-                              currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-
-                            } else { return -1; }
-                          }
-                        }
-                      }
-                    } 
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
+  string labelName = tokens[tokenPosition].text;
+  tokenPosition += 2;
+  outputHelp << "Found label: " << labelName << endl;
 
-      locationCounter+=2;
-      locationCounterGlobal+=2;
+  if(currentSectionId == -1){
+    return -2;
+  }
 
+  int i = searchSymbol(labelName);
+  if(i != -1){
+    Symbol& sym = symbolTable.at(i);
+    if(sym.defined){
+      return -1;
     }
 
-    if(regex_search(s, m, oneOperandInstructions)){
-      outputHelp << "Found instruction with one operand: " << m.str(0) << endl;
-
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
-
-      smatch m1;
-      string s1 = m.str(0);
-      regex_search(s1, m1, symbolRegex);                // remove instruction name
-      string instruction = m1.str(0);
-      s1 = m1.suffix().str();
+    sym.defined = true;
+    sym.value = 0;
+    sym.offset = locationCounter;
+    sym.sectionId = currentSectionId;
+    if(sym.bind == NOBIND) sym.bind = LOCAL;
 
-      regex_search(instruction, m1, symbolOnlyRegex);                // remove instruction name
-      instruction = m1.str(0);
-
-      outputHelp << "Instruction: " << instruction << endl;
-      outputHelp << "Operand: " << s1 << endl;
-
-      if(instruction == "call"){
-        currentSectionMachineCode = addToCode("30", currentSection.name, currentSectionMachineCode);
-      } else {
-        if(instruction == "jmp"){
-          currentSectionMachineCode = addToCode("50", currentSection.name, currentSectionMachineCode);
-        } else {
-          if(instruction == "jeq"){
-            currentSectionMachineCode = addToCode("51", currentSection.name, currentSectionMachineCode);
-          } else {
-            if(instruction == "jne"){
-              currentSectionMachineCode = addToCode("52", currentSection.name, currentSectionMachineCode);
-            } else {
-              if(instruction == "jgt"){
-                currentSectionMachineCode = addToCode("53", currentSection.name, currentSectionMachineCode);
-              } else { return -1; }
-            }
-          }
-        }
-      }
-
-      // register direct
-      if(regex_search(s1, m1, registerDirectJumpRegex)){
-        outputHelp << "Jump Register direct value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, registersRegex);
-        string reg = m1.str(0);
-        string num;
-        outputHelp << "Register found: " << reg << endl; 
-
-        if(reg == "sp"){
-          num = "6";
-        } else {
-          if(reg == "psw"){
-            num = "6";
-          } else {
-            if(regex_search(helper, m1, literalRegex)){
-              num = m1.str(0);
-            } else {
-              return -1;
-            }
-          }
-        }
-        
-        currentSectionMachineCode = addToCode("F" + num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("01", currentSection.name, currentSectionMachineCode);
-
-        locationCounter+=3;
-        locationCounterGlobal+=3;
-        
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // PC REL with symbol
-      if(regex_search(s1, m1, pcRelSymbolJumpRegex)){
-        outputHelp << "Jump PC REL with symbol found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-        
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-
-        currentSectionMachineCode = addToCode("F7", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("05", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-          string symName = m1.str(0);
-          outputHelp << "Symbol found: " << symName << endl;
-          int ret = searchSymbol(symName);
-          int endSize = currentSectionMachineCode.size() - 1;
-          int startSize = currentSectionMachineCode.size() - 2;
-          int size = currentRelocationTable.size();
-          currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-          currentRelocationTable, 0, startSize, endSize);
-
-          if(size == currentRelocationTable.size() && ret != -1){
-            int mov = locationCounter - symbolTable.at(ret).offset - 1;
-            string mov1 = to_string(mov);
-            vector<string> help = decToCode(mov1);
-            bool done = false;
-            for(string s: help){
-              if(!done){
-                currentSectionMachineCode.at(startSize).value = s;
-                done = true;
-              } else {
-                currentSectionMachineCode.at(endSize).value = s;
-              }
-            }
-          }
-        }
-
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // register indirect with literal
-      if(regex_search(s1, m1, registerIndirectLiteralJumpRegex)){
-        outputHelp << "Jump Register indirect with literal value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, registersRegex);
-        string reg = m1.str(0);
-        helper = m1.suffix().str();
-        string num;
-
-        outputHelp << "Register found: " << reg << endl;
-
-        if(reg == "sp"){
-          num = "6";
-        } else {
-          if(reg == "psw"){
-            num = "6";
-          } else {
-            if(regex_search(s1, m1, literalRegex)){
-              num = m1.str(0);
-            } else {
-              return -1;
-            }
-          }
-        }
-
-        regex_search(helper, m1, literalRegex);
-        string lit = m1.str(0);
-
-        outputHelp << "Literal found: " << lit << endl;
-
-        currentSectionMachineCode = addToCode("F" + num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("03", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // register indirect with symbol
-      if(regex_search(s1, m1, registerIndirectSymbolJumpRegex)){
-        outputHelp << "Jump Register indirect with symbol value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, registersRegex);
-        string reg = m1.str(0);
-        helper = m1.suffix().str();
-        string num;
-
-        outputHelp << "Register found: " << reg << endl;
-
-        if(reg == "sp"){
-          num = "6";
-        } else {
-          if(reg == "psw"){
-            num = "6";
-          } else {
-            if(regex_search(reg, m1, literalRegex)){
-              num = m1.str(0);
-            } else {
-              return -1;
-            }
-          }
-        }
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-
-        currentSectionMachineCode = addToCode("F" + num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("03", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-          string symName = m1.str(0);
-          helper = m1.suffix().str();
-          regex_search(symName, m1, symbolNoBracketsRegex);
-          symName = m1.str(0);
-          outputHelp << "Symbol found: " << symName << endl;
-          int ret = searchSymbol(symName);
-          int endSize = currentSectionMachineCode.size() - 1;
-          int startSize = currentSectionMachineCode.size() - 2;
-          int size = currentRelocationTable.size();
-          currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-          currentRelocationTable, 1, startSize, endSize);
-
-          if(size == currentRelocationTable.size() && ret != -1){
-            int mov = locationCounter - symbolTable.at(ret).offset - 1;
-            string mov1 = to_string(mov);
-            vector<string> help = decToCode(mov1);
-            bool done = false;
-            for(string s: help){
-              if(!done){
-                currentSectionMachineCode.at(startSize).value = s;
-                done = true;
-              } else {
-                currentSectionMachineCode.at(endSize).value = s;
-              }
-            }
-          }
-        }
-
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // register indirect
-      if(regex_search(s1, m1, registerIndirectJumpRegex)){
-        outputHelp << "Jump Register indirect value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-        if(regex_search(s1, m1, endBracketRegex)){
-          s1 = m1.suffix().str();
-        }
-
-        regex_search(helper, m1, registersRegex);
-        string reg = m1.str(0);
-        string num;
-
-        outputHelp << "Register found:" << reg << endl;
-
-        if(reg == "sp"){
-          num = "6";
-        } else {
-          if(reg == "psw"){
-            num = "6";
-          } else {
-            if(regex_search(helper, m1, literalRegex)){
-              num = m1.str(0);
-            } else {
-              return -1;
-            }
-          }
-        }
-        
-        currentSectionMachineCode = addToCode("F" + num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("02", currentSection.name, currentSectionMachineCode);
-
-        locationCounter+=3;
-        locationCounterGlobal+=3;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // memory value literal
-      if(regex_search(s1, m1, valueMemLiteralJumpRegex)){
-        outputHelp << "Jump Memory literal value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-
-        regex_search(helper, m1, literalRegex);
-        string lit = m1.str(0);
-
-        currentSectionMachineCode = addToCode("F0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("04", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
-
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // memory value symbol
-      if(regex_search(s1, m1, valueMemSymbolJumpRegex)){
-        outputHelp << "Jump Memory symbol value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, literalRegex);
-        string lit = m1.str(0);
-        outputHelp << "Literal found: " << lit << endl;
-
-        currentSectionMachineCode = addToCode("F0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("04", currentSection.name, currentSectionMachineCode);
-        // TODO
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // literal value
-      if(regex_search(s1, m1, literalRegex)){
-        outputHelp << "Jump literal value found!" << endl;
-        
-        string lit = m1.str(0);
-        string helper = s1;
-        s1 = m1.suffix().str();
-        outputHelp << "Literal found: " << lit << endl;
-
-        currentSectionMachineCode = addToCode("F0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // symbol value
-      if(regex_search(s1, m1, symbolOnlyRegex)){
-        outputHelp << "Jump symbol value found!" << endl;
-
-        string symName = m1.str(0);
-        string helper = s1;
-        s1 = m1.suffix().str();
-        int ret = searchSymbol(symName);
-        outputHelp << "Symbol found: " << symName << endl;
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        currentSectionMachineCode = addToCode("F0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        int endSize = currentSectionMachineCode.size() - 1;
-        int startSize = currentSectionMachineCode.size() - 2;
-        int size = currentRelocationTable.size();
-        currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-        currentRelocationTable, 1, startSize, endSize);
-
-        if(size == currentRelocationTable.size() && ret != -1){
-          int mov = locationCounter - symbolTable.at(ret).offset - 1;
-          string mov1 = to_string(mov);
-          vector<string> help = decToCode(mov1);
-          bool done = false;
-          for(string s: help){
-            if(!done){
-              currentSectionMachineCode.at(startSize).value = s;
-              done = true;
-            } else {
-              currentSectionMachineCode.at(endSize).value = s;
-            }
-          }
-        }
-
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
+    for(Relocation& rel: currentRelocationTable){
+      if(rel.symbolId == sym.id && rel.type == R_PC16){
+        rel.type = R_16;
+        break;
       }
-
     }
 
-    if(regex_search(s, m, oneOperandOneRegisterInstructions)){
-      outputHelp << "Found instruction with one operand and one register: " << m.str(0) << endl;
+    backPatching(sym, currentSection.id, locationCounter, currentSectionMachineCode, currentRelocationTable);
+    backPatchingRelocation(sym);
 
-      if(m.prefix().str() != "" || m.suffix().str() != ""){
-        return -1;
-      }
+  } else {
+    Symbol sym;
+    sym.name = labelName;
+    sym.value = 0;
+    sym.defined = true;
+    sym.bind = LOCAL;
+    sym.offset = locationCounter;
+    sym.type = NOTYP;
+    sym.id = symbolId++;
+    sym.sectionId = currentSectionId;
+    addSymbol(sym);
+  }
 
-      smatch m1;
-      string s1 = m.str(0);
+  return 0;
+}
 
-      regex_search(s1, m1, symbolOnlyRegex);            
-      string instruction = m1.str(0);
+/**
+ * @brief parses assembler directive, directive is current token
+ *
+ * @return int 0 - it is good, 1 - end directive, -1 - syntax error, -2 - directive needs section
+ */
+int Assembler::parseDirective(){
+
+  string directive = tokens[tokenPosition++].text;
+  outputHelp << "Found directive: " << directive << endl;
+
+  if(directive == ".global" || directive == ".extern"){
+    string symbolName;
+    do{
+      if(!expectSymbol(symbolName)) return -1;
+      declareGlobal(symbolName);
+    } while(accept(COMMA_TOKEN));
+    return 0;
+  }
 
-      regex_search(s1, m1, symbolRegex);                // remove instruction name
-      instruction = m1.str(0);
-      s1 = m1.suffix().str();
+  if(directive == ".section"){
+    string name;
+    if(!expectSymbol(name)) return -1;
+    outputHelp << "Section name: " << name << endl;
 
-      regex_search(instruction, m1, symbolOnlyRegex);                // remove instruction name
-      instruction = m1.str(0);
+    Section section;
+    section.id = sectionId++;
+    section.name = name;
+    section.base = locationCounterGlobal;
 
-      outputHelp << "Instruction: " << instruction << endl;
-      outputHelp << "Operands: " << s1 << endl;
+    if(currentSection.name == ""){
+      currentSection = section;
+    } else {
+      currentSection.length = locationCounter;
+      sectionTable.push_back(currentSection);
+      currentSection = section;
+      locationCounter = 0;
+      this->machineCode.push_back(std::move(currentSectionMachineCode));
+      this->relocationTable.push_back(std::move(currentRelocationTable));
+      currentSectionMachineCode.clear();
+      currentRelocationTable.clear();
+    }
 
-      regex_search(s1, m1, registersRegex);
-      string reg = m1.str(0);
-      s1 = m1.suffix().str();
+    if(searchSymbol(name) != -1){
+      return -1;            // mislim da ne moze da postoje vise sekcija sa isitm imenom ili labela i sekcija sa istim imenom
+    }
 
-      outputHelp << "Register found: " << reg << endl;
+    Symbol sym;
+    sym.name = name;
+    sym.defined = false;
+    sym.size = 0;
+    sym.value = 0;
+    sym.type = SCTN;
+    sym.bind = NOBIND;
+    currentSectionId = sym.sectionId = sym.id = symbolId++;
+    sym.offset = locationCounter;
+    addSymbol(sym);
+    return 0;
+  }
 
-      if(regex_search(s1, m1, commaRegex)){
-        s1 = m1.suffix().str();
-      }
+  if(directive == ".word"){
+    if(currentSectionId == -1){
+      return -2;
+    }
 
-      if(instruction == "ldr"){
-        currentSectionMachineCode = addToCode("A0", currentSection.name, currentSectionMachineCode);
+    do{
+      locationCounter += 2;
+      locationCounterGlobal += 2;
+      string symName;
+      if(peek().type == LITERAL_TOKEN){
+        outputHelp << "Literal found: " << peek().text << endl;
+        addLiteralToCode(tokens[tokenPosition++].text, true);
       } else {
-        if(instruction == "str"){
-        currentSectionMachineCode = addToCode("B0", currentSection.name, currentSectionMachineCode);
-        } else { return -1; }
+        if(!expectSymbol(symName)) return -1;
+        addSymbolToCode(symName, 2);
       }
+    } while(accept(COMMA_TOKEN));
+    return 0;
+  }
 
-      string num;
-      regex_search(reg, m1, literalRegex);
-
-      if(reg == "sp") num = "6";
-        else if(reg == "psw") num = "8";
-          else {
-            if(regex_search(reg, m1, literalRegex))
-              num = m1.str(0);
-          }
-
-      // PC REL with symbol
-      if(regex_search(s1, m1, pcRelSymbolDataRegex)){
-        outputHelp << "PC REL with symbol found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-
-        currentSectionMachineCode = addToCode(num + "0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("05", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-          string symName = m1.str(0);
-          int ret = searchSymbol(symName);
-          outputHelp << "Symbol found: " << symName << endl;
-          int endSize = currentSectionMachineCode.size() - 1;
-          int startSize = currentSectionMachineCode.size() - 2;
-          int size = currentRelocationTable.size();
-          currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-          currentRelocationTable, 0, startSize, endSize);
-
-          if(size == currentRelocationTable.size() && ret != -1){
-            int mov = locationCounter - symbolTable.at(ret).offset - 1;
-            string mov1 = to_string(mov);
-            vector<string> help = decToCode(mov1);
-            bool done = false;
-            for(string s: help){
-              if(!done){
-                currentSectionMachineCode.at(startSize).value = s;
-                done = true;
-              } else {
-                currentSectionMachineCode.at(endSize).value = s;
-              }
-            }
-          }
-        }
-
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-
-      // memory value literal
-      if(regex_search(s1, m1, valueLiteralDataRegex)){
-        outputHelp << "Literal value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, literalRegex);
-        string lit = m1.str(0);
-        outputHelp << "Literal found: " << lit << endl;
-        s1 = m1.suffix().str();
-
-        currentSectionMachineCode = addToCode(num + "0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
+  if(directive == ".skip"){
+    if(currentSectionId == -1){
+      return -2;
+    }
+    if(peek().type != LITERAL_TOKEN){
+      return -1;
+    }
 
-        locationCounter+=5;
-        locationCounterGlobal+=5;
+    string literal = tokens[tokenPosition++].text;
+    outputHelp << "Literal: " << literal << endl;
 
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
+    int num = stoi(literal);
+    locationCounter += num;
+    locationCounterGlobal += num;
+    for(int i = 0; i < num; i++){
+       addToCode(0x00, currentSectionMachineCode);
+    }
+    return 0;
+  }
 
-      }
+  if(directive == ".end"){
+    return 1;
+  }
 
-      // memory value symbol
-      if(regex_search(s1, m1, valueSymbolDataRegex)){
-        outputHelp << "Symbol value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        currentSectionMachineCode = addToCode(num + "0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-        if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-          string symName = m1.str(0);
-          int ret = searchSymbol(symName);
-          outputHelp << "Symbol found: " << symName << endl;
-          int endSize = currentSectionMachineCode.size() - 1;
-          int startSize = currentSectionMachineCode.size() - 2;
-          int size = currentRelocationTable.size();
-          currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-          currentRelocationTable, 1, startSize, endSize);
-
-          if(size == currentRelocationTable.size() && ret != -1){
-            int mov = locationCounter - symbolTable.at(ret).offset - 1;
-            string mov1 = to_string(mov);
-            vector<string> help = decToCode(mov1);
-            bool done = false;
-            for(string s: help){
-              if(!done){
-                currentSectionMachineCode.at(startSize).value = s;
-                done = true;
-              } else {
-                currentSectionMachineCode.at(endSize).value = s;
-              }
-            }
-          }
-        }
+  return -1;
+}
 
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
+/**
+ * @brief parses instruction, instruction name is current token
+ *
+ * @return int 0 - it is good, -1 - syntax error, -2 - instruction is not in section
+ */
+int Assembler::parseInstruction(){
+
+  struct Opcode{
+    const char* name;
+    uint8_t code;
+  };
+  static const Opcode noOperands[] = {{"halt", 0x00}, {"iret", 0x20}, {"ret", 0x40}};
+  static const Opcode jumps[] = {{"call", 0x30}, {"jmp", 0x50}, {"jeq", 0x51}, {"jne", 0x52}, {"jgt", 0x53}};
+  static const Opcode twoRegisters[] = {{"xchg", 0x60}, {"add", 0x70}, {"sub", 0x71}, {"mul", 0x72},
+    {"div", 0x73}, {"cmp", 0x74}, {"and", 0x81}, {"or", 0x82}, {"xor", 0x83}, {"test", 0x84},
+    {"shl", 0x90}, {"shr", 0x91}};
+
+  string instruction = tokens[tokenPosition++].text;
+  outputHelp << "Found instruction: " << instruction << endl;
+
+  if(currentSectionId == -1){
+    return -2;
+  }
 
-      // register indirect
-      if(regex_search(s1, m1, registerIndirectDataRegex)){
-        if(m1.suffix().str() == "]"){
-          outputHelp << "Register indirect value found!" << endl;
-          string helper = s1;
-          s1 = m1.suffix().str();
-          regex_search(s1, m1, endBracketRegex);
-          s1 = m1.suffix().str();
-
-          regex_search(helper, m1, registersRegex);
-          string reg2 = m1.str(0);
-          outputHelp << "Register found: " << reg2 << endl;
-
-          if(reg2 == "sp") num += "6";
-          else if(reg2 == "psw") num += "8";
-            else {
-              if(regex_search(reg2, m1, literalRegex))
-                num += m1.str(0);
-            }
-
-          currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("02", currentSection.name, currentSectionMachineCode);
-
-          locationCounter+=3;
-          locationCounterGlobal+=3;
-          if(s1 != ""){
-            return -1;
-          } else {
-            continue;
-          }
-        }
+  for(const auto& ins: noOperands){
+    if(instruction == ins.name){
+      addToCode(ins.code, currentSectionMachineCode);
+      locationCounter++;
+      locationCounterGlobal++;
+      return 0;
+    }
+  }
 
-      }
+  if(instruction == "push" || instruction == "pop" || instruction == "int" || instruction == "not"){
+    string reg;
+    if(!expectRegister(reg)) return -1;
+    outputHelp << "Register found: " << reg << endl;
+    uint8_t num = registerCode(reg);
+
+    if(instruction == "push"){
+      addToCode(0xB0, currentSectionMachineCode);
+      addToCode(num << 4 | 0x6, currentSectionMachineCode);
+      addToCode(0x12, currentSectionMachineCode);
+      locationCounter += 3;
+      locationCounterGlobal += 3;
+    } else if(instruction == "pop"){
+      addToCode(0xA0, currentSectionMachineCode);
+      addToCode(num << 4 | 0x6, currentSectionMachineCode);
+      addToCode(0x42, currentSectionMachineCode);
+      locationCounter += 3;
+      locationCounterGlobal += 3;
+    } else if(instruction == "int"){
+      addToCode(0x10, currentSectionMachineCode);
+      addToCode(num << 4 | 0xF, currentSectionMachineCode);
+      locationCounter += 2;
+      locationCounterGlobal += 2;
+    } else {
+      addToCode(0x80, currentSectionMachineCode);
+      addToCode(num << 4 | num, currentSectionMachineCode);
+      locationCounter += 2;
+      locationCounterGlobal += 2;
+    }
+    return 0;
+  }
 
-      // register indirect with symbol
-      if(regex_search(s1, m1, registerIndirectSymbolDataRegex)){
-        string help1 = m1.suffix().str();
-        regex_search(help1, m1, helperSymbolRegex);
-        if(m1.suffix().str() != ""){
-          outputHelp << "Register indirect with symbol value found!" << endl;
-          string helper = s1;
-          s1 = m1.suffix().str();
-
-          regex_search(s1, m1, endBracketRegex);
-          s1 = m1.suffix().str();
-
-          locationCounter+=5;
-          locationCounterGlobal+=5;
-
-          regex_search(helper, m1, registersRegex);
-          string reg2 = m1.str(0);
-          outputHelp << "Register found: " << reg2 << endl;
-          helper = m1.suffix().str();
-
-          if(reg2 == "sp") num += "6";
-          else if(reg2 == "psw") num += "8";
-            else {
-              if(regex_search(reg2, m1, literalRegex))
-                num += m1.str(0);
-            }
-
-          currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("03", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-          if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-            string symName = m1.str(0);
-            regex_search(symName, m1, endBracketRegex);
-            symName = m1.prefix().str();
-            outputHelp << "Symbol found: " << symName << endl;
-            int ret = searchSymbol(symName);
-            int endSize = currentSectionMachineCode.size() - 1;
-            int startSize = currentSectionMachineCode.size() - 2;
-            int size = currentRelocationTable.size();
-            currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-            currentRelocationTable, 1, startSize, endSize);
-
-            if(size == currentRelocationTable.size() && ret != -1){
-              int mov = locationCounter - symbolTable.at(ret).offset - 1;
-              string mov1 = to_string(mov);
-              vector<string> help = decToCode(mov1);
-              bool done = false;
-              for(string s: help){
-                if(!done){
-                  currentSectionMachineCode.at(startSize).value = s;
-                  done = true;
-                } else {
-                  currentSectionMachineCode.at(endSize).value = s;
-                }
-              }
-            }
-          }
-
-          if(s1 != ""){
-            return -1;
-          } else {
-            continue;
-          }
-        }
-      }
+  for(const auto& ins: twoRegisters){
+    if(instruction == ins.name){
+      string r1, r2;
+      if(!expectRegister(r1) || !accept(COMMA_TOKEN) || !expectRegister(r2)) return -1;
+      outputHelp << "Registers found: " << r1 << " " << r2 << endl;
+
+      addToCode(ins.code, currentSectionMachineCode);
+      addToCode(registerCode(r1) << 4 | registerCode(r2), currentSectionMachineCode);
+      locationCounter += 2;
+      locationCounterGlobal += 2;
+      return 0;
+    }
+  }
 
-      // register indirect with literal
-      if(regex_search(s1, m1, registerIndirectLiteralDataRegex)){
-        outputHelp << "Register indirect with literal value found!" << endl;
-        string helper = s1;
-        s1 = m1.suffix().str();
-
-        regex_search(s1, m1, endBracketRegex);
-        s1 = m1.suffix().str();
-
-        regex_search(helper, m1, registersRegex);
-        string reg2 = m1.str(0);
-        helper = m1.suffix().str();
-        regex_search(helper, m1, literalRegex);
-        string lit = m1.str(0);
-        helper = m1.suffix().str();
-
-        outputHelp << "Register found: " << reg2 << endl;
-        outputHelp << "Literal found: " << lit << endl;
-
-        if(reg2 == "sp") num += "6";
-        else if(reg2 == "psw") num += "8";
-          else {
-            if(regex_search(reg2, m1, literalRegex))
-              num += m1.str(0);
-          }
-
-        currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("03", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
-
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
+  for(const auto& ins: jumps){
+    if(instruction == ins.name){
+      Operand op;
+      if(!parseOperand(true, op)) return -1;
 
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
+      addToCode(ins.code, currentSectionMachineCode);
+      addOperandToCode(0xF, op, true);
+      return 0;
+    }
+  }
 
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
+  if(instruction == "ldr" || instruction == "str"){
+    string reg;
+    Operand op;
+    if(!expectRegister(reg) || !accept(COMMA_TOKEN) || !parseOperand(false, op)) return -1;
+    outputHelp << "Register found: " << reg << endl;
 
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }        
-      }
+    addToCode(instruction == "ldr" ? 0xA0 : 0xB0, currentSectionMachineCode);
+    addOperandToCode(registerCode(reg), op, false);
+    return 0;
+  }
 
-      // register direct
-      if(regex_search(s1, m1, registersRegex)){
-        outputHelp << "Register direct value found!" << endl;
-        string reg2 = m1.str(0);
-        s1 = m1.suffix().str();
-        if(regex_search(s1, m1, endBracketRegex)){
-          s1 = m1.suffix().str();
-        }
+  return -1;
+}
 
-        outputHelp << "Register found: " << reg2 << endl;
+/**
+ * @brief parses one line: [label:] [directive | instruction]
+ *
+ * @return int 0 - it is good, 1 - end directive, -1 - syntax error, -2 - some labels or code are not in section
+ */
+int Assembler::parseLine(){
 
-        if(reg2 == "sp") num += "6";
-        else if(reg2 == "psw") num += "8";
-          else {
-            if(regex_search(reg2, m1, literalRegex))
-              num += m1.str(0);
-          }
+  if(peek().type == SYMBOL_TOKEN && peek(1).type == COLON_TOKEN){
+    int ret = parseLabel();
+    if(ret != 0) return ret;
+  }
 
-        currentSectionMachineCode = addToCode(num, currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("01", currentSection.name, currentSectionMachineCode);
+  int ret = 0;
+  switch(peek().type){
+    case END_TOKEN:
+      return 0;
 
-        locationCounter+=3;
-        locationCounterGlobal+=3;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
+    case DIRECTIVE_TOKEN:
+      ret = parseDirective();
+      break;
 
-      // symbol value
-      if(regex_search(s1, m1, symbolRegex)){
-        string helper = s1;
-        s1 = m1.suffix().str();
-        if(!regex_search(helper, m1, registersRegex)){
-
-          locationCounter+=5;
-          locationCounterGlobal+=5;
-
-          currentSectionMachineCode = addToCode(num + "0", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("04", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-          currentSectionMachineCode = addToCode("00", currentSection.name, currentSectionMachineCode);
-
-          if(regex_search(helper, m1, symbolOnlyRegex)){       // add to forward if needed
-            string symName = m1.str(0);
-            int ret = searchSymbol(symName);
-            outputHelp << "Symbol found: " << symName << endl;
-            int endSize = currentSectionMachineCode.size() - 1;
-            int startSize = currentSectionMachineCode.size() - 2;
-            int size = currentRelocationTable.size();
-            currentRelocationTable = addSymbolOrForwardElement(ret, symName, currentSectionId, locationCounter, currentSection, 
-            currentRelocationTable, 1, startSize, endSize);
-
-            if(size == currentRelocationTable.size() && ret != -1){
-              int mov = locationCounter - symbolTable.at(ret).offset - 1;
-              string mov1 = to_string(mov);
-              vector<string> help = decToCode(mov1);
-              bool done = false;
-              for(string s: help){
-                if(!done){
-                  currentSectionMachineCode.at(startSize).value = s;
-                  done = true;
-                } else {
-                  currentSectionMachineCode.at(endSize).value = s;
-                }
-              }
-            }
-          }
-
-          outputHelp << "Memory symbol value found!" << endl;
-        }
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
+    case SYMBOL_TOKEN:
+      ret = parseInstruction();
+      break;
 
-      // literal value
-      if(regex_search(s1, m1, literalRegex)){
-        outputHelp << "Memory literal value found!" << endl;
+    default:
+      return -1;
+  }
 
-        string lit = m1.str(0);
-        s1 = m1.suffix().str();
+  if(ret < 0) return ret;
+  if(peek().type != END_TOKEN) return -1;
+  return ret;
+}
 
-        outputHelp << "Literal found: " << lit << endl;
+/**
+ * @brief One and only pass of assembler
+ *
+ * @return int 0 - it is good, -1 - syntax error, -2 - some labels or code are not in section,
+ * -4 - object file couldn't be written
+ */
+int Assembler::pass(){
 
-        currentSectionMachineCode = addToCode(num + "0", currentSection.name, currentSectionMachineCode);
-        currentSectionMachineCode = addToCode("04", currentSection.name, currentSectionMachineCode);
-        if(regex_search(lit, m1, hexRegex)){
-          string num2 = m1.str(0);
-          regex_search(num2, m1, hexRemoveRegex);
-          num2 = m1.suffix().str();
-          vector<string> help = hexToCode(num2);
+  if(!openFiles()){
+    return -3;
+  }
 
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
+  size_t lastindex = outputFileString.find_last_of(".");
+  string outputFileHelpString = outputFileString.substr(0, lastindex) + "Helper.o";
+  outputHelp.open(outputFileHelpString, ios::out|ios::trunc);
 
-        } else {
-          string num2 = lit;
-          vector<string> help = decToCode(num2);
+  locationCounter = 0;
+  locationCounterGlobal = 0;
+  currentSection.name = "";
+  currentSectionId = -1;
 
-          for(string s: help){
-            currentSectionMachineCode = addToCode(s, currentSection.name, currentSectionMachineCode);
-          }
-        }
+  // lines are tokenized straight from the input stream, only the current one is kept
+  string line;
+  while(getline(this->inputFile, line)){
 
-        locationCounter+=5;
-        locationCounterGlobal+=5;
-        if(s1 != ""){
-          return -1;
-        } else {
-          continue;
-        }
-      }
-      
+    if(!tokenize(line)){
+      outputHelp << line << endl;
+      return -1;
     }
 
-    if(s != "") {
-      outputHelp << s << endl;
-      return -1;
+    // line is emtpy
+    if(peek().type == END_TOKEN){
+      outputHelp << "Skipped line" << endl;
+      continue;
     }
 
+    int ret = parseLine();
+    if(ret == 1){
+      break;
+    }
+    if(ret != 0){
+      outputHelp << line << endl;
+      return ret;
+    }
   }
 
   currentSection.length = locationCounter;
   sectionTable.push_back(currentSection);
-  machineCode.push_back(currentSectionMachineCode);
-  relocationTable.push_back(currentRelocationTable);
+  machineCode.push_back(std::move(currentSectionMachineCode));
+  relocationTable.push_back(std::move(currentRelocationTable));
 
   printOutput();
+  if(!writeObjectFile()) return -4;
 
   return 0;
 }
@@ -2040,37 +1047,149 @@ bool checkInputData(string options, string outputFile, string inputFile){
 
 }
 
+/**
+ * @brief checks value of -threads option
+ * 
+ * @param value text after "-threads="
+ * @param threads number of threads that is set
+ * @return true value is positive number
+ * @return false value is bad
+ */
+bool checkThreads(string value, unsigned& threads){
+  try{
+    size_t pos;
+    int n = stoi(value, &pos);
+    threads = n;
+    return pos == value.size() && n > 0;
+  }
+  catch(const std::exception& e){   // bad number
+    return false;
+  }
+}
+
+/**
+ * @brief throws exception that belongs to return code of Assembler::pass()
+ * 
+ * @param ret return code of pass
+ */
+void checkReturnCode(int ret){
+  if(ret == -1){
+    throw BadSyntaxException();
+  }
+  if(ret == -2){
+    throw NoSectionException();
+  }
+  if(ret == -3){
+    throw NonexistantInputFileException();
+  }
+  if(ret == -4){
+    throw ObjectFileException();
+  }
+}
+
+/**
+ * @brief reads manifest for batch mode, every line is "<output>.o <input>.s", empty lines and lines 
+ * starting with # are skipped
+ * 
+ * @param manifest name of manifest file
+ * @param files pairs of output and input file that are read
+ * @return true manifest is good
+ * @return false manifest doesn't exist or some line is bad
+ */
+bool readManifest(const string& manifest, vector<pair<string, string>>& files){
+
+  ifstream in(manifest, ios::in);
+  if(!in.is_open()) return false;
+
+  string line;
+  while(getline(in, line)){
+    stringstream ss(line);
+    string outputFile, inputFile, rest;
+    if(!(ss >> outputFile) || outputFile[0] == '#') continue;
+    if(!(ss >> inputFile) || (ss >> rest)) return false;
+    files.push_back({outputFile, inputFile});
+  }
+
+  return true;
+}
+
+/**
+ * @brief assembles every pair of output and input file on its own Assembler, files are assembled in parallel
+ * and errors are written in order of files
+ * 
+ * @param files pairs of output and input file
+ * @param threads number of threads
+ */
+void assembleBatch(const vector<pair<string, string>>& files, unsigned threads){
+
+  vector<string> errors(files.size());
+  parallelFor(files.size(), threads, [&](size_t i){
+    try{
+      Assembler assembler(files[i].first, files[i].second);
+      checkReturnCode(assembler.pass());
+    }
+    catch(const std::exception& e){
+      errors[i] = e.what();
+    }
+  });
+
+  for(size_t i = 0; i < files.size(); i++){
+    if(errors[i] != "") std::cerr << files[i].second << ": " << errors[i] << '\n';
+  }
+}
+
 int main(int argc, char const *argv[]){
   
   try{
-    if(!argv[1] || !argv[2] || !argv[3]) throw InputException();
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    bool batch = false;
+    vector<pair<string, string>> files;
+    vector<string> args;
+
+    for(int i = 1; i < argc; i++){
+      string arg = argv[i];
+      if(arg.compare(0, 9, "-threads=") == 0){       // -threads=<N>, number of files assembled at once
+        if(!checkThreads(arg.substr(9), threads)) throw InputException();
+      } else if(arg == "-batch"){                     // -batch <input>.s ..., <input>.o is output of every input
+        batch = true;
+      } else if(arg.compare(0, 10, "-manifest=") == 0){   // -manifest=<file>, lines of "<output>.o <input>.s"
+        if(!readManifest(arg.substr(10), files)) throw NonexistantInputFileException();
+        batch = true;
+      } else {
+        args.push_back(arg);
+      }
+    }
 
-    string options = argv[1];
-    string outputFile = argv[2];
-    string inputFile = argv[3];
+    if(!batch){
+      if(args.size() < 3) throw InputException();
 
-    if(!checkInputData(options, outputFile, inputFile)){
-      throw InputException();
-    }
+      string options = args[0];
+      string outputFile = args[1];
+      string inputFile = args[2];
 
-    Assembler assembler(outputFile, inputFile);
+      if(!checkInputData(options, outputFile, inputFile)){
+        throw InputException();
+      }
 
-    int ret = assembler.pass();
-    if(ret == -1){
-      throw BadSyntaxException();
+      Assembler assembler(outputFile, inputFile);
+      checkReturnCode(assembler.pass());
+      return 0;
     }
-    if(ret == -2){
-      throw NoSectionException();
+
+    for(const string& inputFile: args){
+      files.push_back({inputFile.substr(0, inputFile.find_last_of(".")) + ".o", inputFile});
     }
-    if(ret == -2){
-      throw NonexistantInputFileException();
+    if(files.size() == 0) throw InputException();
+
+    for(const pair<string, string>& file: files){
+      if(!checkInputData("-o", file.first, file.second)) throw InputException();
     }
 
-    
+    assembleBatch(files, threads);
   }
   catch(const std::exception& e){
     std::cerr << e.what() << '\n';
   }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,89 +1,18 @@
 #include <iostream>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <cstring>
-#include <regex>
 #include <fstream>
 #include <iomanip>
+#include <unordered_map>
+#include <sstream>
+#include <thread>
+#include "../common/object.hpp"
+#include "../common/parallel.hpp"
 
 using namespace std;
 
-// helper strings
-string registers = "r[0-7]|sp|psw";
-string literal = "0x[0-9a-fA-F]+|[-]?[0-9][0-9]*";
-string symbol = "[a-zA-Z][a-zA-z0-9_]*";
-
-string symbolOrLiteral = literal + "|" + symbol;
-string listSymbols = "(" + symbol + "(,[ ]* " + symbol + ")*)$";
-string listSymbolsAndLiterals = "((" + symbol + "|" + literal +")((, " + symbol + "|" + literal + "))*)$";
-
-string operandsForData = "\\$(" + literal + ")|\\$" + symbol + "|" + literal + "|" + symbol + "|%" + symbol 
-+ "|" + registers + "|\\[" + registers + " \\+ " + literal + "\\]|\\[" + registers + " \\+ " + symbol + "\\]|\\[" 
-+ registers + "\\]";
-
-string operandsForJumps = literal + "|" + symbol + "|%" + symbol + "|\\*(" + literal + ")|\\*" + symbol + "|\\*" 
-  + registers + "|\\*\\[" + registers + " \\+ " + literal + "\\]|\\*\\[" + registers + " \\+ " + literal 
-  + "\\]|\\*\\[" + registers + "\\]";
-
-// register, symbols, labels regex, literal
-regex registersRegex(registers);
-regex labelRegex("^" + symbol + ":[ ]*");
-
-regex symbolRegex(symbol + "[ ]*");
-regex symbolOnlyRegex(symbol);
-regex symbolNoBracketsRegex(symbol + "[^\\[\\]\\(\\) +-]");
-regex literalRegex(literal);
-regex symbolOrLiteralRegex(symbolOrLiteral);
-regex operandsForJumpsRegex(operandsForJumps);
-
-// assembler directives regex
-regex globalRegex("^\\.global " + listSymbols + "$");
-regex externRegex("^\\.extern " + listSymbols + "$");
-regex sectionRegex("^\\.section " + symbol + "$");
-regex wordRegex("^\\.word " + listSymbolsAndLiterals + "$");
-regex wordOnlyRegex("^\\.word ");
-// regex skipRegex("^\\.skip " + literal + "$");  // ovo gore nece nzm zasto ali neka ostane tako
-regex skipRegex("^\\.skip");
-regex endRegex("^\\.end$");
-
-// assembler instructions regex
-regex noOperandsInstructions("^(halt|iret|ret)$");
-regex oneRegisterInsturctions("^(int|push|pop|not) " + registers + "$");
-regex oneOperandInstructions("^(call|jmp|jeq|jne|jgt) (.)+$");
-regex oneOperandOneRegisterInstructions("^(ldr|str) (.)+$");
-regex twoRegistersInstructions("^(xchg|add|sub|mul|div|cmp|and|or|xor|test|shl|shr) (" + registers + "),[ ]*(" + registers + ")$");
-
-// helper regex
-regex tabsRegex("\t");
-regex extraSpacesRegex("[ ]+");
-regex startSpacesRegex("^[ ]+");
-regex commentsRegex("#.*");
-regex spacesRegex("[ ]*");
-regex endSpacesRegex("[ ]*$");
-regex commaRegex(", ");
-regex endBracketRegex("\\]");
-regex hexRegex("0x[0-9a-fA-F]+");
-regex hexRemoveRegex("0x");
-regex decRegex("[-]?[0-9][0-9]*");
-regex helperSymbolRegex(symbol);
-
-// regex for operands for jumps
-regex pcRelSymbolJumpRegex("%" + symbol);
-regex valueMemLiteralJumpRegex("\\*("  + literal + ")");
-regex valueMemSymbolJumpRegex("\\*("  + symbol + ")");
-regex registerDirectJumpRegex("\\*" + registers);
-regex registerIndirectJumpRegex("\\*(\\[" + registers + "\\])");
-regex registerIndirectLiteralJumpRegex("\\*\\[(" + registers + ") \\+ (" + literal + ")\\]");
-regex registerIndirectSymbolJumpRegex("\\*\\[(" + registers + ") \\+ (" + symbol + ")\\]");
-
-// regex for operands for data
-regex valueLiteralDataRegex("\\$(" + literal + ")");
-regex valueSymbolDataRegex("\\$(" + symbol + ")");
-regex pcRelSymbolDataRegex("\\%" + symbol);
-regex registerIndirectDataRegex("\\[" + registers + "\\]");
-regex registerIndirectLiteralDataRegex("\\[" + registers + " \\+ (" + literal + ")\\]");
-regex registerIndirectSymbolDataRegex("\\[" + registers + " \\+ (" + symbol + ")\\]");
-
 class Assembler{
 
 public:
@@ -94,16 +23,45 @@ public:
 private:
 
   bool openFiles();
-  void setGoodLines();
   void printOutput();
-  int searchSymbol(string symbolName);
+  bool writeObjectFile();
 
   string outputFileString, inputFileString;
   ifstream inputFile;
   ofstream outputFile;
-  vector<string> goodLines;
+  ofstream outputHelp;
+
+  enum TokenType{SYMBOL_TOKEN, LITERAL_TOKEN, DIRECTIVE_TOKEN, COMMA_TOKEN, COLON_TOKEN, DOLLAR_TOKEN, PERCENT_TOKEN, 
+    STAR_TOKEN, LBRACKET_TOKEN, RBRACKET_TOKEN, PLUS_TOKEN, END_TOKEN};
+  struct Token{
+    TokenType type;
+    string text;
+  };
+  vector<Token> tokens;             // tokens of the line that is parsed, always ends with END_TOKEN
+  size_t tokenPosition;
+
+  bool tokenize(const string& line);
+  const Token& peek(size_t ahead = 0);
+  bool accept(TokenType type);
+  bool expectSymbol(string& name);
+  bool expectRegister(string& reg);
+
+  enum OperandType{REG_DIR, REG_IND, REG_IND_LIT, REG_IND_SYM, LIT_VALUE, SYM_VALUE, LIT_MEM, SYM_MEM, SYM_PCREL};
+  struct Operand{
+    OperandType type;
+    string reg;
+    string literal;
+    string symbol;
+  };
 
-  static int sectionId;
+  bool parseOperand(bool jump, Operand& op);
+  bool parseLocation(Operand& op);
+  int parseLine();
+  int parseLabel();
+  int parseDirective();
+  int parseInstruction();
+
+  int sectionId;                    // next section id, every Assembler counts from 0
   struct Section{
     string name;
     int base;
@@ -128,7 +86,7 @@ private:
     int offsetRelo;
   };
 
-  static int symbolId;
+  int symbolId;                     // next symbol id, every Assembler counts from 0
   struct Symbol{
     int id;
     string name;
@@ -142,60 +100,54 @@ private:
     vector<Forwarding> forwardingTable;
   };
   vector<Symbol> symbolTable;
+  unordered_map<string, int> symbolIndex;   // symbol name -> index in symbolTable
+
+  int searchSymbol(const string& symbolName);
+  void addSymbol(const Symbol& sym);
+
+  vector<vector<uint8_t>> machineCode;    // machineCode[i] is code of sectionTable[i]
 
-  struct MachineCode{
-    // string address;
-    string value;
-    string sectionName;
+  struct Relocation{
+    int sectionId;
+    int offset;
+    RelocationType type;
+    int addend;
+    int symbolId;
   };
-  vector<vector<MachineCode>> machineCode;
+  vector<vector<Relocation>> relocationTable;
 
-  vector<MachineCode> backPatching(Symbol sym, int sectionId, int locationCounter, vector<MachineCode> code){
-    for(Forwarding fw: sym.forwardingTable){
+  /**
+   * @brief patches forward references to symbol that is defined in current section
+   * 
+   * @param sym             symbol that is defined
+   * @param sectionId       id of current section
+   * @param locationCounter current location counter
+   * @param code            machine code of current section
+   * @param relocations     relocation table of current section
+   */
+  void backPatching(const Symbol& sym, int sectionId, int locationCounter, vector<uint8_t>& code, 
+    const vector<Relocation>& relocations){
+    for(const Forwarding& fw: sym.forwardingTable){
       if(fw.sectionID == sectionId){
         int mov = locationCounter - fw.mcend - 1;
-        string mov1 = to_string(mov);
-        vector<string> help = decToCode(mov1);
-        bool done = false;
 
-        if(relocationTable[sectionId][fw.offsetRelo].type == R_WORD16){
-          code.at(fw.mcstart).value = help[1];
-          code.at(fw.mcend).value = help[0];
+        if(relocations.at(fw.offsetRelo).type == R_WORD16){
+          code.at(fw.mcstart) = mov & 0xFF;
+          code.at(fw.mcend) = (mov >> 8) & 0xFF;
         } else {
-          if(relocationTable[sectionId][fw.offsetRelo].type == R_16){
-            for(string s: help){
-              if(!done){
-                code.at(fw.mcstart).value = s;
-                done = true;
-              } else {
-                code.at(fw.mcend).value = s;
-              }
-            }
+          if(relocations.at(fw.offsetRelo).type == R_16){
+            code.at(fw.mcstart) = (mov >> 8) & 0xFF;
+            code.at(fw.mcend) = mov & 0xFF;
           }
         }
       }
     }
-
-    return code;
   }
 
-  struct Relocation{
-    int sectionId;
-    int offset;
-    RelocationType type;
-    int addend;
-    int symbolId;
-  };
-  vector<vector<Relocation>> relocationTable;
-
-  void backPatchingRelocation(Symbol sym);
+  void backPatchingRelocation(const Symbol& sym);
 
-  vector<MachineCode> addToCode(string value, string sectionName, vector<MachineCode> machineCodes){
-    MachineCode mc;
-    mc.value = value;
-    mc.sectionName = sectionName;
-    machineCodes.push_back(mc);
-    return machineCodes;
+  void addToCode(uint8_t value, vector<uint8_t>& code){
+    code.push_back(value);
   };
 
   /**
@@ -206,9 +158,10 @@ private:
    * @param currentSectionId  id of current section
    * @param locationCounter   current location counter
    * @param currentSection    current section
+   * @param relocationTable   relocation table of current section, relocation is appended to it
    */
-  vector<Relocation> addSymbolOrForwardElement(int ret, string symName, int currentSectionId, int locationCounter, 
-    Section currentSection, vector<Relocation> relocationTable, int pc, int startSize, int endSize){
+  void addSymbolOrForwardElement(int ret, const string& symName, int currentSectionId, int locationCounter, 
+    const Section& currentSection, vector<Relocation>& relocationTable, int pc, int startSize, int endSize){
     if(ret == -1){
       Symbol symb;
       symb.name = symName;
@@ -232,11 +185,11 @@ private:
       fwd.offsetRelo = relocationTable.size();
 
       symb.forwardingTable.push_back(fwd);
-      symbolTable.push_back(symb);
-      relocationTable = addRelocation(relocationTable, locationCounter, currentSection.id, symb.id, pc);
+      addSymbol(symb);
+      addRelocation(relocationTable, locationCounter, currentSection.id, symb.id, pc);
     } else {                                        // there is symbol at table
 
-      Symbol symb = symbolTable.at(ret);
+      Symbol& symb = symbolTable.at(ret);
       if(symb.defined){
         //TODO
       } else {  
@@ -251,15 +204,13 @@ private:
         fwd.offsetRelo = relocationTable.size();
 
         symb.forwardingTable.push_back(fwd);
-        symbolTable.at(ret) = symb;
-        relocationTable = addRelocation(relocationTable, locationCounter, currentSection.id, symb.id, pc);
+        addRelocation(relocationTable, locationCounter, currentSection.id, symb.id, pc);
       }
     
     }
-    return relocationTable;
   }
 
-  vector<Relocation> addRelocation(vector<Relocation> relocationTable, int locationCounter, int sectionId, int symbolId, int pc){
+  void addRelocation(vector<Relocation>& relocationTable, int locationCounter, int sectionId, int symbolId, int pc){
     Relocation rel;
 
     rel.offset = locationCounter - 2;
@@ -280,9 +231,17 @@ private:
     }
 
     relocationTable.push_back(rel);
-    return relocationTable;
   }
 
-  vector<string> hexToCode(string num);
-  vector<string> decToCode(string num);
+  int locationCounter;
+  int locationCounterGlobal;
+  Section currentSection;
+  int currentSectionId;
+  vector<uint8_t> currentSectionMachineCode;
+  vector<Relocation> currentRelocationTable;
+
+  void declareGlobal(const string& symbolName);
+  void addLiteralToCode(const string& literal, bool littleEndian);
+  void addSymbolToCode(const string& symName, int pc);
+  void addOperandToCode(uint8_t first, const Operand& op, bool jump);
 };
\ No newline at end of file
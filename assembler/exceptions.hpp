@@ -32,4 +32,13 @@ public:
 
     return "Not in section @ line: ";
   };
-};
\ No newline at end of file
+};
+
+class ObjectFileException: public std::exception{
+
+public:
+  const char* what() const throw(){
+
+    return "Object file couldn't be written";
+  };
+};
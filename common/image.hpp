@@ -0,0 +1,24 @@
+#include <cstdint>
+
+// Raw memory image written by linker with -binary and loaded by emulator.
+// File is one ImageHeader, rangeCount ImageRanges and IMAGE_MEMORY_SIZE bytes of memory.
+// Ranges only tell which parts of memory are populated, whole memory is always in file.
+
+const char IMAGE_MAGIC[4] = {'S', 'S', 'I', 'M'};
+const uint16_t IMAGE_VERSION = 1;
+const uint32_t IMAGE_MEMORY_SIZE = 65536;
+
+struct ImageHeader{
+  char magic[4];
+  uint16_t version;
+  uint16_t entry;             // first pc of program
+  uint32_t rangeCount;
+};
+
+struct ImageRange{
+  uint32_t start;
+  uint32_t size;
+};
+
+static_assert(sizeof(ImageHeader) == 12, "ImageHeader has to stay fixed-size");
+static_assert(sizeof(ImageRange) == 8, "ImageRange has to stay fixed-size");
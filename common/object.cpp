@@ -0,0 +1,144 @@
+#include "object.hpp"
+#include <cstring>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief adds string to string table
+ *
+ * @param str string that is added
+ * @return uint32_t offset of string in string table
+ */
+uint32_t ObjectFile::addString(const string& str){
+  uint32_t offset = strings.size();
+  strings.insert(strings.end(), str.begin(), str.end());
+  strings.push_back('\0');
+  return offset;
+}
+
+/**
+ * @brief writes object to file
+ *
+ * @param fileName name of object file
+ * @return true object is written
+ * @return false file couldn't be written
+ */
+bool ObjectFile::write(const string& fileName) const{
+
+  ObjectHeader header;
+  memcpy(header.magic, OBJECT_MAGIC, sizeof(header.magic));
+  header.version = OBJECT_VERSION;
+  header.reserved = 0;
+  header.sectionCount = sections.size();
+  header.symbolCount = symbols.size();
+  header.relocationCount = relocations.size();
+  header.stringTableSize = strings.size();
+  header.codeSize = code.size();
+
+  ofstream out(fileName, ios::out|ios::trunc|ios::binary);
+  if(!out.is_open()) return false;
+
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)sections.data(), sections.size() * sizeof(ObjectSection));
+  out.write((const char*)symbols.data(), symbols.size() * sizeof(ObjectSymbol));
+  out.write((const char*)relocations.data(), relocations.size() * sizeof(ObjectRelocation));
+  out.write(strings.data(), strings.size());
+  out.write((const char*)code.data(), code.size());
+
+  return out.good();
+}
+
+ObjectView::ObjectView(ObjectView&& other)
+  : header(other.header), sections(other.sections), symbols(other.symbols), relocations(other.relocations),
+  strings(other.strings), code(other.code), mapping(other.mapping), mappingSize(other.mappingSize){
+  other.mapping = nullptr;
+  other.mappingSize = 0;
+}
+
+ObjectView::~ObjectView(){
+  if(mapping) munmap(mapping, mappingSize);
+}
+
+/**
+ * @brief maps object file in memory and checks that all offsets are inside of it
+ *
+ * @param fileName name of object file
+ * @return true object is mapped
+ * @return false file doesn't exist or it isn't valid object file
+ */
+bool ObjectView::open(const string& fileName){
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+
+  struct stat st;
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ObjectHeader)){
+    close(fd);
+    return false;
+  }
+
+  void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(ptr == MAP_FAILED) return false;
+
+  mapping = ptr;
+  mappingSize = st.st_size;
+
+  header = (const ObjectHeader*)mapping;
+  if(memcmp(header->magic, OBJECT_MAGIC, sizeof(header->magic)) != 0 || header->version != OBJECT_VERSION)
+    return false;
+
+  uint64_t expected = sizeof(ObjectHeader) + (uint64_t)header->sectionCount * sizeof(ObjectSection) +
+    (uint64_t)header->symbolCount * sizeof(ObjectSymbol) + (uint64_t)header->relocationCount * sizeof(ObjectRelocation) +
+    header->stringTableSize + header->codeSize;
+  if(expected != mappingSize) return false;
+
+  const char* position = (const char*)mapping + sizeof(ObjectHeader);
+  sections = (const ObjectSection*)position;
+  position += header->sectionCount * sizeof(ObjectSection);
+  symbols = (const ObjectSymbol*)position;
+  position += header->symbolCount * sizeof(ObjectSymbol);
+  relocations = (const ObjectRelocation*)position;
+  position += header->relocationCount * sizeof(ObjectRelocation);
+  strings = position;
+  position += header->stringTableSize;
+  code = (const uint8_t*)position;
+
+  return check();
+}
+
+/**
+ * @brief checks that names, code and relocations of mapped object are inside of file
+ */
+bool ObjectView::check() const{
+
+  if(header->stringTableSize == 0 || strings[header->stringTableSize - 1] != '\0') return false;
+
+  for(uint32_t k = 0; k < header->sectionCount; k++){
+    const ObjectSection& sec = sections[k];
+    if(sec.name >= header->stringTableSize || (uint64_t)sec.codeOffset + sec.size > header->codeSize ||
+      (uint64_t)sec.relocationStart + sec.relocationCount > header->relocationCount) return false;
+    if(k == 0 && sec.relocationCount != 0) return false;     // UND section has no code to relocate
+
+    for(uint32_t i = sec.relocationStart; i < sec.relocationStart + sec.relocationCount; i++){
+      if((uint64_t)relocations[i].offset + 2 > sec.size) return false;
+    }
+  }
+
+  for(uint32_t i = 0; i < header->symbolCount; i++){
+    if(symbols[i].name >= header->stringTableSize) return false;
+    if(symbols[i].sectionId != OBJECT_UND_SECTION &&
+      (symbols[i].sectionId < 0 || (uint32_t)symbols[i].sectionId >= header->symbolCount)) return false;
+  }
+
+  for(uint32_t i = 0; i < header->relocationCount; i++){
+    if(relocations[i].symbolId < 0 || (uint32_t)relocations[i].symbolId >= header->symbolCount) return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary relocatable object written by assembler (linker.<name>.o) and mapped by linker.
+// File is one ObjectHeader followed by sectionCount ObjectSections, symbolCount ObjectSymbols,
+// relocationCount ObjectRelocations, string table and code of all sections one after another.
+// All numbers are written in host byte order and all records are 4 byte aligned in file,
+// so mapped file can be used in place.
+
+const char OBJECT_MAGIC[4] = {'S', 'S', 'O', 'B'};
+const uint16_t OBJECT_VERSION = 1;
+const int32_t OBJECT_UND_SECTION = -1;      // sectionId of symbols that are not defined in this file
+
+enum ObjectSymbolType{OBJECT_NOTYP, OBJECT_SCTN};
+enum ObjectSymbolBind{OBJECT_GLOBAL, OBJECT_LOCAL, OBJECT_NOBIND};
+enum ObjectRelocationType{OBJECT_R_16, OBJECT_R_PC16, OBJECT_R_WORD16};
+
+struct ObjectHeader{
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t sectionCount;
+  uint32_t symbolCount;
+  uint32_t relocationCount;
+  uint32_t stringTableSize;
+  uint32_t codeSize;
+};
+
+// Section 0 is always UND section, it has no code and no relocations.
+struct ObjectSection{
+  uint32_t name;              // offset in string table
+  uint32_t size;
+  uint32_t codeOffset;        // offset in code, code of section is size bytes long
+  uint32_t relocationStart;   // index of first relocation of section
+  uint32_t relocationCount;
+};
+
+struct ObjectSymbol{
+  uint32_t name;              // offset in string table
+  int32_t id;
+  int32_t offset;
+  int32_t sectionId;          // index of section's symbol in this file, OBJECT_UND_SECTION if symbol isn't defined here
+  uint8_t type;               // ObjectSymbolType
+  uint8_t bind;               // ObjectSymbolBind
+  uint8_t defined;
+  uint8_t reserved;
+};
+
+struct ObjectRelocation{
+  uint32_t offset;            // offset in section's code
+  int32_t symbolId;           // index of symbol in this file
+  int32_t addend;
+  uint8_t type;               // ObjectRelocationType
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(ObjectHeader) == 28, "ObjectHeader has to stay fixed-size");
+static_assert(sizeof(ObjectSection) == 20, "ObjectSection has to stay fixed-size");
+static_assert(sizeof(ObjectSymbol) == 20, "ObjectSymbol has to stay fixed-size");
+static_assert(sizeof(ObjectRelocation) == 16, "ObjectRelocation has to stay fixed-size");
+
+class ObjectFile{
+
+public:
+
+  std::vector<ObjectSection> sections;
+  std::vector<ObjectSymbol> symbols;
+  std::vector<ObjectRelocation> relocations;
+  std::vector<char> strings;
+  std::vector<uint8_t> code;
+
+  uint32_t addString(const std::string& str);
+  const char* name(uint32_t offset) const{
+    return strings.data() + offset;
+  };
+
+  bool write(const std::string& fileName) const;
+};
+
+// Read-only view of object file that is mapped in memory, records point straight into mapping.
+class ObjectView{
+
+public:
+
+  ObjectView(){};
+  ObjectView(const ObjectView&) = delete;
+  ObjectView(ObjectView&& other);
+  ~ObjectView();
+
+  bool open(const std::string& fileName);
+
+  const ObjectHeader* header = nullptr;
+  const ObjectSection* sections = nullptr;
+  const ObjectSymbol* symbols = nullptr;
+  const ObjectRelocation* relocations = nullptr;
+  const char* strings = nullptr;
+  const uint8_t* code = nullptr;
+
+  std::string_view name(uint32_t offset) const{
+    return std::string_view(strings + offset);
+  };
+
+private:
+
+  bool check() const;
+
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+};
@@ -0,0 +1,31 @@
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Small thread pool helper used by assembler and linker.
+
+/**
+ * @brief runs job(0) ... job(count - 1) on worker threads, every index is taken by exactly one thread
+ *
+ * @param count number of jobs
+ * @param threads number of threads that are used
+ * @param job job that is run for one index
+ */
+inline void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& job){
+
+  if(threads > count) threads = count;
+  if(threads <= 1){
+    for(size_t i = 0; i < count; i++) job(i);
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for(unsigned t = 0; t < threads; t++){
+    workers.emplace_back([&](){
+      for(size_t i = next++; i < count; i = next++) job(i);
+    });
+  }
+  for(std::thread& worker: workers) worker.join();
+}
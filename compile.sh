@@ -1,3 +1,4 @@
-g++ -g -o asembler ./assembler/assembler.cpp
-g++ -g -o linkerr ./linker/linker.cpp
-g++ -g -o emulatorr ./emulator/emulator.cpp
\ No newline at end of file
+g++ -g -std=c++17 -pthread -o asembler ./assembler/assembler.cpp ./common/object.cpp
+g++ -g -std=c++17 -pthread -o linkerr ./linker/linker.cpp ./common/object.cpp
+g++ -g -std=c++17 -pthread -o emulatorr ./emulator/emulator.cpp
+g++ -g -std=c++17 -o emutracee ./emutrace/emutrace.cpp
\ No newline at end of file
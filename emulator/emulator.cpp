@@ -4,13 +4,14 @@
 /**
  * @brief Checks input data
  * 
- * @param inputFile input files has to be .hex
+ * @param inputFile input files has to be .hex or .bin (memory image)
  * @return true everything is good
  * @return false something is bad
  */
 bool checkInputData(string inputFile){
 
-  if(inputFile.substr(inputFile.find_last_of(".")+1) == "hex") return true;
+  string extension = inputFile.substr(inputFile.find_last_of(".")+1);
+  if(extension == "hex" || extension == "bin") return true;
   else return false;
 }
 
@@ -18,54 +19,301 @@ bool checkInputData(string inputFile){
  * @brief Construct a new Emulator:: Emulator object
  * 
  * @param inputFile input file name
+ * @param options options from terminal
  */
-Emulator::Emulator(string inputFile){
+Emulator::Emulator(string inputFile, Options options){
   inputFileName = inputFile;
-  Memory.clear();
+  this->options = options;
+  setDispatchTable();
+  memset(Memory, 0, sizeof(Memory));
+  instructionCache.assign(MEMORY_SIZE, Instruction());
+  instructionCacheValid.assign(MEMORY_SIZE, false);
+  translatedCode.assign(MEMORY_SIZE, false);
   for(int i = 0; i < 9; i++){
     reg[i] = 0;
   }
-  Interrupts.clear();
 }
 
 /**
- * @brief turns dec number to machine code
+ * @brief Reads 16-bit little-endian word from memory
  * 
- * @param num the number that need to be changed
- * @return vector<string> helper machine code
+ * @param address address of lower byte, wraps around 64 KiB
+ * @return unsigned short word at address
  */
-vector<string> Emulator::decToCode(string num){
-  vector<string> ret;
-  
-  int n = stoi(num);
-  char help[8];
-  sprintf(help, "%X", n);
-  string help1 = (string)help;
-
-  if(help1.size() == 4){
-    ret.push_back(help1.substr(0,2));
-    ret.push_back(help1.substr(2,2));
-  } else {
-    if(help1.size() == 3){
-      ret.push_back("0" + help1.substr(0,1));
-      ret.push_back(help1.substr(1,2));
-    } else {
-      if(help1.size() == 2){
-        ret.push_back("00");
-        ret.push_back(help1.substr(0,2));
-      } else {
-        if(help1.size() == 1){
-          ret.push_back("00");
-          ret.push_back("0" + help1);
-        } else {  // here it means it is negative number
-          ret.push_back(help1.substr(4,2));
-          ret.push_back(help1.substr(6,2));
-        }        
+unsigned short Emulator::readWord(unsigned int address){
+  return Memory[address & ADDRESS_MASK] | (Memory[(address + 1) & ADDRESS_MASK] << 8);
+}
+
+/**
+ * @brief Writes lower 16 bits of value to memory in little-endian order
+ * 
+ * @param address address of lower byte, wraps around 64 KiB
+ * @param value value that is written
+ */
+void Emulator::writeWord(unsigned int address, unsigned int value){
+  Memory[address & ADDRESS_MASK] = value & 0xFF;
+  Memory[(address + 1) & ADDRESS_MASK] = (value >> 8) & 0xFF;
+  invalidateInstructionCache(address);
+  memoryWrites++;
+
+  if(translatedCode[address & ADDRESS_MASK] || translatedCode[(address + 1) & ADDRESS_MASK]){
+    blockCacheDirty = true;
+    exitBlock = true;
+  }
+
+  if((address & ADDRESS_MASK) >= MMIO_START - 1) writeRegister(address & ADDRESS_MASK);
+}
+
+/**
+ * @brief Lets device react to write into its register, value is already in memory
+ * 
+ * @param address address of lower byte that was written
+ */
+void Emulator::writeRegister(unsigned int address){
+  if(address == TERM_OUT || address + 1 == TERM_OUT) writeTerminal(Memory[TERM_OUT]);
+  if(address + 1 >= TIM_CFG && address <= TIM_CFG + 1) startTimer();
+}
+
+/**
+ * @brief Called on backward jumps. If pc and registers are same as on previous backward jump and nothing was written
+ * in between, program is in loop without side effects that repeats until some device event, so emulated time
+ * skips to first event in whole loop iterations
+ * 
+ */
+void Emulator::checkIdle(){
+
+  unsigned long long next = nextEventCycle;     // read once, reader thread can wake emulator meanwhile
+  if(reg[7] == idleRegisters[7] && memoryWrites == idleWrites && memcmp(reg, idleRegisters, sizeof(reg)) == 0 &&
+    next != ~0ULL && next > cycles && cycles > idleCycle){
+    unsigned long long iteration = cycles - idleCycle;
+    cycles += (next - cycles + iteration - 1) / iteration * iteration;
+  }
+
+  memcpy(idleRegisters, reg, sizeof(reg));
+  idleWrites = memoryWrites;
+  idleCycle = cycles;
+}
+
+/**
+ * @brief Adds event to scheduler
+ * 
+ * @param cycle cycle when event happens
+ * @param device device that handles event
+ * @param generation generation of device when event is scheduled
+ */
+void Emulator::scheduleEvent(unsigned long long cycle, Device device, unsigned int generation){
+  events.push({cycle, device, generation});
+  updateNextEvent();
+}
+
+/**
+ * @brief Runs all events whose cycle has come, periodic devices schedule their next event
+ * 
+ */
+void Emulator::runEvents(){
+
+  memoryWrites++;     // devices can change memory and interrupts, loop that was idle before may not be anymore
+
+  // new input is polled right away, unless poll is already scheduled for characters that came before
+  if(terminalWake.exchange(false) && !terminalPolling) pollTerminal(cycles);
+
+  while(!events.empty() && events.top().cycle <= cycles){
+    Event event = events.top();
+    events.pop();
+
+    switch(event.device){
+      case TIMER_DEVICE:
+        if(event.generation != timerGeneration) break;    // tim_cfg was changed after event was scheduled
+        addInterrupt(TIMER_ENTRY);
+        scheduleEvent(event.cycle + timerPeriod(), TIMER_DEVICE, event.generation);
+        break;
+
+      case TERMINAL_DEVICE:
+        pollTerminal(event.cycle);
+        break;
+    }
+  }
+
+  updateNextEvent();
+}
+
+/**
+ * @brief Sets nextEventCycle to first event in queue. Wake from reader is checked after store, so wake that
+ * happens during store isn't overwritten
+ * 
+ */
+void Emulator::updateNextEvent(){
+  nextEventCycle = events.empty() ? ~0ULL : events.top().cycle;
+  if(terminalWake) nextEventCycle = 0;
+}
+
+/**
+ * @brief Returns timer period set in tim_cfg
+ * 
+ * @return unsigned long long period in cycles
+ */
+unsigned long long Emulator::timerPeriod(){
+  static const unsigned int periods[8] = {500, 1000, 1500, 2000, 5000, 10000, 30000, 60000};   // ms
+  return periods[readWord(TIM_CFG) & 7] * CYCLES_PER_MS;
+}
+
+/**
+ * @brief (Re)starts timer with period from tim_cfg, events of previous period are dropped
+ * 
+ */
+void Emulator::startTimer(){
+  timerGeneration++;
+  scheduleEvent(cycles + timerPeriod(), TIMER_DEVICE, timerGeneration);
+}
+
+/**
+ * @brief With -terminal puts stdin in raw mode if it is terminal and starts reader thread, reader wakes
+ * emulator when input comes
+ * 
+ */
+void Emulator::startTerminal(){
+
+  if(!options.terminal) return;     // stdin isn't touched, term_out still works
+
+  if(isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &terminalSettings) == 0){
+    struct termios raw = terminalSettings;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+
+    // shell mustn't be left in raw mode if emulator is stopped or exits without stopTerminal()
+    atexit(restoreTerminal);
+    for(int sig: {SIGINT, SIGTERM, SIGQUIT, SIGHUP, SIGABRT}) signal(sig, terminalSignal);
+    terminalRaw = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+  }
+
+  if(pipe(terminalWakePipe) != 0) return;     // without pipe reader couldn't be stopped, there is no input then
+
+  terminalReader = thread(&Emulator::readTerminal, this);
+}
+
+/**
+ * @brief Stops reader thread, restores terminal and prints what is left in output buffer
+ * 
+ */
+void Emulator::stopTerminal(){
+
+  if(terminalReader.joinable()){
+    terminalStop = true;
+    if(write(terminalWakePipe[1], "", 1) < 0){}
+    terminalReader.join();
+    close(terminalWakePipe[0]);
+    close(terminalWakePipe[1]);
+  }
+
+  restoreTerminal();
+  flushTerminal();
+}
+
+struct termios Emulator::terminalSettings;
+volatile sig_atomic_t Emulator::terminalRaw = 0;
+
+/**
+ * @brief Restores terminal settings from before raw mode, only uses async-signal-safe calls
+ * 
+ */
+void Emulator::restoreTerminal(){
+  if(terminalRaw) tcsetattr(STDIN_FILENO, TCSANOW, &terminalSettings);
+  terminalRaw = 0;
+}
+
+/**
+ * @brief Signal handler that restores terminal and then lets signal do its default action
+ * 
+ * @param sig signal
+ */
+void Emulator::terminalSignal(int sig){
+  restoreTerminal();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+/**
+ * @brief Reader thread, waits for stdin without blocking emulation and pushes characters to terminalInput
+ * 
+ */
+void Emulator::readTerminal(){
+
+  struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {terminalWakePipe[0], POLLIN, 0}};
+  char buffer[64];
+
+  while(!terminalStop){
+    if(poll(fds, 2, -1) < 0){
+      if(errno == EINTR) continue;
+      break;
+    }
+    if(fds[1].revents) break;           // emulator halted
+    if(!fds[0].revents) continue;
+
+    ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if(n <= 0) break;                   // end of input
+
+    for(ssize_t i = 0; i < n && !terminalStop; i++){
+      while(!terminalInput.push(buffer[i]) && !terminalStop){
+        this_thread::sleep_for(chrono::milliseconds(1));     // queue is full, emulated program is slower
       }
     }
+    wakeTerminal();
+  }
+}
+
+/**
+ * @brief Called by reader thread, makes emulator run events on next instruction so that input is polled
+ * 
+ */
+void Emulator::wakeTerminal(){
+  terminalWake = true;
+  nextEventCycle = 0;
+}
+
+/**
+ * @brief Moves next character from reader thread to term_in and raises terminal interrupt, next character
+ * waits until previous interrupt is accepted. Poll is repeated only while queue has characters, empty
+ * queue is polled again when reader wakes emulator, so idle loops skip to real device events.
+ * 
+ * @param cycle cycle of poll
+ */
+void Emulator::pollTerminal(unsigned long long cycle){
+
+  terminalPolling = false;
+  char c;
+  if(!(pendingInterrupts & (1 << TERMINAL_ENTRY)) && terminalInput.pop(c)){
+    Memory[TERM_IN] = c;
+    Memory[TERM_IN + 1] = 0;
+    invalidateInstructionCache(TERM_IN);
+    addInterrupt(TERMINAL_ENTRY);
+  }
+
+  if(!terminalInput.empty()){
+    terminalPolling = true;
+    scheduleEvent(cycle + TERMINAL_POLL_CYCLES, TERMINAL_DEVICE, 0);
   }
+}
 
-  return ret;
+/**
+ * @brief Adds character written to term_out to output buffer
+ * 
+ * @param c character
+ */
+void Emulator::writeTerminal(char c){
+  terminalBuffer[terminalBufferSize++] = c;
+  if(c == '\n' || terminalBufferSize == TERMINAL_BUFFER_SIZE) flushTerminal();
+}
+
+/**
+ * @brief Prints output buffer with one write
+ * 
+ */
+void Emulator::flushTerminal(){
+  if(terminalBufferSize == 0) return;
+  cout.write(terminalBuffer, terminalBufferSize);
+  cout.flush();
+  terminalBufferSize = 0;
 }
 
 /**
@@ -75,56 +323,100 @@ vector<string> Emulator::decToCode(string num){
  * @return false input file does not exist
  */
 bool Emulator::openFile(){
-  inputFile.open(inputFileName, ios::in);
+  inputFile.open(inputFileName, ios::in|ios::binary);
 
   if(inputFile.is_open()) return true;
   else return false;
 }
 
 /**
- * @brief Loads Memory before emulation
+ * @brief Loads Memory before emulation, only segments from hex file are written and the rest of memory stays zero.
+ * Segment starts with "@<address> <length>" line and its bytes follow in "XXXX: " lines,
+ * file without segment lines is one segment from address 0
  * 
+ * @return true everything is good
+ * @return false segment is outside of memory or has more bytes than its length
  */
-void Emulator::loadMemory(){
+bool Emulator::loadMemory(){
 
   string line;
+  unsigned long address = 0;
+  unsigned long end = MEMORY_SIZE;        // end of current segment
   while(getline(inputFile, line)){
 
-    line.erase(0, 6); // remove "XXXX: "
+    const char* position = line.c_str();
+    char* next;
+
+    if(*position == '@'){
+      address = strtoul(position + 1, &next, 16);
+      if(next == position + 1) return false;
+      position = next;
+      end = address + strtoul(position, &next, 16);
+      if(next == position || address > MEMORY_SIZE || end > MEMORY_SIZE) return false;
+      continue;
+    }
+
+    position = strchr(position, ':');   // skip "XXXX: "
+    if(position == nullptr) continue;
+    position++;
 
-    size_t pos = 0;
-    string delimiter = " ";
-    while((pos = line.find(delimiter)) != std::string::npos){
-      string token = line.substr(0, pos);
-      line.erase(0, pos + delimiter.length());
-      Memory.push_back(token);
+    while(true){
+      unsigned long byte = strtoul(position, &next, 16);
+      if(next == position) break;
+      if(address >= end || byte > 0xFF) return false;
+      Memory[address++] = byte;
+      position = next;
     }
-    Memory.push_back(line);     // proveri mozda ne treba to
   }
 
-  for(int i = Memory.size(); i < 65536; i++) Memory.push_back("00");
+  return true;
+}
+
+/**
+ * @brief Loads raw memory image written by linker with -binary, whole memory is read with one read
+ * 
+ * @return true image is loaded and pc is set to its entry
+ * @return false file isn't valid memory image
+ */
+bool Emulator::loadImage(){
+
+  ImageHeader header;
+  if(!inputFile.read((char*)&header, sizeof(header))) return false;
+  if(memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 || header.version != IMAGE_VERSION ||
+    header.rangeCount > IMAGE_MEMORY_SIZE) return false;
+
+  vector<ImageRange> ranges(header.rangeCount);
+  if(!inputFile.read((char*)ranges.data(), ranges.size() * sizeof(ImageRange))) return false;
+  for(const ImageRange& range: ranges){
+    if(range.start > IMAGE_MEMORY_SIZE || range.size > IMAGE_MEMORY_SIZE - range.start) return false;
+  }
+
+  static_assert(MEMORY_SIZE == IMAGE_MEMORY_SIZE, "image has to cover whole memory");
+  if(!inputFile.read((char*)Memory, MEMORY_SIZE)) return false;
 
+  reg[7] = header.entry;
+  return true;
 }
 
 /**
  * @brief Returns Operation code for set byte
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::OPCode 
  */
-Emulator::OPCode Emulator::getOPCode(char s){
-  if(s == '0') return HALT;
-  else if(s == '1') return INT;
-  else if(s == '2') return IRET;
-  else if(s == '3') return CALL;
-  else if(s == '4') return RET;
-  else if(s == '5') return JUMP;
-  else if(s == '6') return XCHG;
-  else if(s == '7') return ARITHMETIC;
-  else if(s == '8') return LOGIC;
-  else if(s == '9') return SHIFT;
-  else if(s == 'A') return LOAD;
-  else if(s == 'B') return STORE;
+Emulator::OPCode Emulator::getOPCode(uint8_t s){
+  if(s == 0x0) return HALT;
+  else if(s == 0x1) return INT;
+  else if(s == 0x2) return IRET;
+  else if(s == 0x3) return CALL;
+  else if(s == 0x4) return RET;
+  else if(s == 0x5) return JUMP;
+  else if(s == 0x6) return XCHG;
+  else if(s == 0x7) return ARITHMETIC;
+  else if(s == 0x8) return LOGIC;
+  else if(s == 0x9) return SHIFT;
+  else if(s == 0xA) return LOAD;
+  else if(s == 0xB) return STORE;
   else return ERROROP;
 }
 
@@ -152,14 +444,14 @@ string Emulator::toStringOPCode(){
 /**
  * @brief Return what type of Jump it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::JumpInstr 
  */
-Emulator::JumpInstr Emulator::getJumpType(char s){
-  if(s == '0') return JMP;
-  else if(s == '1') return JEQ;
-  else if(s == '2') return JNE;
-  else if(s == '3') return JGT;
+Emulator::JumpInstr Emulator::getJumpType(uint8_t s){
+  if(s == 0x0) return JMP;
+  else if(s == 0x1) return JEQ;
+  else if(s == 0x2) return JNE;
+  else if(s == 0x3) return JGT;
   else return ERRORJMP;
 }
 
@@ -180,19 +472,19 @@ string Emulator::toStringJumpType(){
 /**
  * @brief Return what register it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::Registers 
  */
-Emulator::Registers Emulator::getRegister(char s){
-  if(s == '0') return R0;
-  else if(s == '1') return R1;
-  else if(s == '2') return R2;
-  else if(s == '3') return R3;
-  else if(s == '4') return R4;
-  else if(s == '5') return R5;
-  else if(s == '6') return R6;
-  else if(s == '7') return R7;
-  else if(s == '8') return R8;
+Emulator::Registers Emulator::getRegister(uint8_t s){
+  if(s == 0x0) return R0;
+  else if(s == 0x1) return R1;
+  else if(s == 0x2) return R2;
+  else if(s == 0x3) return R3;
+  else if(s == 0x4) return R4;
+  else if(s == 0x5) return R5;
+  else if(s == 0x6) return R6;
+  else if(s == 0x7) return R7;
+  else if(s == 0x8) return R8;
   else return ERRORREG;
 }
 
@@ -218,16 +510,16 @@ string Emulator::toStringRegister(Emulator::Registers reg){
 /**
  * @brief Return what type of address it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::AddressType 
  */
-Emulator::AddressType Emulator::getAddressType(char s){
-  if(s == '0') return IMMED;
-  else if(s == '1') return REGDIR;
-  else if(s == '2') return REGIND;
-  else if(s == '3') return REGINDPOM;
-  else if(s == '4') return MEMDIR;
-  else if(s == '5') return REGDIRPOM;
+Emulator::AddressType Emulator::getAddressType(uint8_t s){
+  if(s == 0x0) return IMMED;
+  else if(s == 0x1) return REGDIR;
+  else if(s == 0x2) return REGIND;
+  else if(s == 0x3) return REGINDPOM;
+  else if(s == 0x4) return MEMDIR;
+  else if(s == 0x5) return REGDIRPOM;
   else return ERRORADDR;
 }
 
@@ -249,15 +541,15 @@ string Emulator::toStringAddressType(){
 /**
  * @brief Return what type of address update it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::AddressUpdate 
  */
-Emulator::AddressUpdate Emulator::getAddressUpdate(char s){
-  if(s == '0') return NOUPD;
-  else if(s == '1') return DECBEFORE;
-  else if(s == '2') return INCBEFORE;
-  else if(s == '3') return DECAFTER;
-  else if(s == '4') return INCAFTER;
+Emulator::AddressUpdate Emulator::getAddressUpdate(uint8_t s){
+  if(s == 0x0) return NOUPD;
+  else if(s == 0x1) return DECBEFORE;
+  else if(s == 0x2) return INCBEFORE;
+  else if(s == 0x3) return DECAFTER;
+  else if(s == 0x4) return INCAFTER;
   else return ERRORUPD;
 }
 
@@ -273,56 +565,56 @@ string Emulator::toStringAddressUpdate(){
 /**
  * @brief Return what type of arithmetic instruction it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::ArithmeticInstr 
  */
-Emulator::ArithmeticInstr Emulator::getArithmeticInstr(char s){
-  if(s == '0') return ADD;
-  else if(s == '1') return SUB;
-  else if(s == '2') return MUL;
-  else if(s == '3') return DIV;
-  else if(s == '4') return CMP;
+Emulator::ArithmeticInstr Emulator::getArithmeticInstr(uint8_t s){
+  if(s == 0x0) return ADD;
+  else if(s == 0x1) return SUB;
+  else if(s == 0x2) return MUL;
+  else if(s == 0x3) return DIV;
+  else if(s == 0x4) return CMP;
   else return ERRORARITHMETHIC;
 }
 
 /**
  * @brief Return what type of logic instruction it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::LogicInstr 
  */
-Emulator::LogicInstr Emulator::getLogicInstr(char s){
-  if(s == '0') return NOT;
-  else if(s == '1') return AND;
-  else if(s == '2') return OR;
-  else if(s == '3') return XOR;
-  else if(s == '4') return TEST;
+Emulator::LogicInstr Emulator::getLogicInstr(uint8_t s){
+  if(s == 0x0) return NOT;
+  else if(s == 0x1) return AND;
+  else if(s == 0x2) return OR;
+  else if(s == 0x3) return XOR;
+  else if(s == 0x4) return TEST;
   else return ERRORLOGIC;
 }
 
 /**
  * @brief Return what type of shift instruction it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::ShiftInstr 
  */
-Emulator::ShiftInstr Emulator::getShiftInstr(char s){
-  if(s == '0') return SHL;
-  else if(s == '1') return SHR;
+Emulator::ShiftInstr Emulator::getShiftInstr(uint8_t s){
+  if(s == 0x0) return SHL;
+  else if(s == 0x1) return SHR;
   else return ERRORSHIFT;
 }
 
 /**
  * @brief Return what type of jump instruction it is
  * 
- * @param s input byte
+ * @param s input nibble
  * @return Emulator::JumpInstr 
  */
-Emulator::JumpInstr Emulator::getJumpInstr(char s){
-  if(s == '0') return JMP;
-  else if(s == '1') return JEQ;
-  else if(s == '2') return JNE;
-  else if(s == '3') return JGT;
+Emulator::JumpInstr Emulator::getJumpInstr(uint8_t s){
+  if(s == 0x0) return JMP;
+  else if(s == 0x1) return JEQ;
+  else if(s == 0x2) return JNE;
+  else if(s == 0x3) return JGT;
   else return ERRORJMP;
 }
 
@@ -360,115 +652,110 @@ int Emulator::getRegIndex(Registers reg){
 }
 
 /**
- * @brief Adds interrupt to Interrupts
+ * @brief Returns 16-bit payload of 5B instruction
  * 
+ * @return unsigned int payload, dataHigh is the first byte
  */
-void Emulator::addInterrupt(){
-  Interrupt interrupt;
-  interrupt.entry = 1;
-  interrupt.interruptType = NOTMASKED;
-  Interrupts.push_back(interrupt);
+unsigned int Emulator::getInstructionData(){
+  return instruction.data;
 }
 
 /**
- * @brief Checks if there are unmasked interrupts
+ * @brief Marks interrupt as pending, same interrupt that is already pending is accepted only once
  * 
- * @return int -1 no unmasked interrupts
+ * @param entry IVT entry of interrupt, error by default
  */
-int Emulator::checkUnmaskedInterrupts(){
-  if(Interrupts.size() == 0) return -1;
+void Emulator::addInterrupt(unsigned int entry){
+  pendingInterrupts |= 1 << entry;
+  exitBlock = true;
+}
 
-  int ret = 0;
-  for(Interrupt intt: Interrupts){
-    if(intt.interruptType == NOTMASKED) return ret;
-    ret++;
-  }
-  return -1;
+/**
+ * @brief Returns IVT entries that psw doesn't mask, I masks all maskable interrupts,
+ * Tr masks timer and Tl masks terminal
+ * 
+ * @return uint8_t bit i - interrupt for entry i can be accepted
+ */
+uint8_t Emulator::unmaskedInterrupts(){
+  if(reg[8] & PSW_I) return NONMASKABLE_INTERRUPTS;
+
+  uint8_t mask = 0xFF;
+  if(reg[8] & PSW_TR) mask &= ~(1 << TIMER_ENTRY);
+  if(reg[8] & PSW_TL) mask &= ~(1 << TERMINAL_ENTRY);
+  return mask;
 }
 
 /**
  * @brief PC <= operand, has same code for jump operations so to shorten code
  * 
+ * @return true jump target is accepted
+ * @return false operand is bad, error interrupt is raised and PC isn't changed
  */
-void Emulator::PCJumpChange(){
+bool Emulator::PCJumpChange(){
 
-  stringstream ss;
-  string data, dataLow, dataHigh;
-  unsigned int indexS, dataInt;
+  int indexS;
+  unsigned int dataInt = getInstructionData(), data = 0;
+  unsigned int next = reg[7];     // address after jump
   switch(instruction.addressType){
     case IMMED:
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> reg[7];
+      reg[7] = dataInt;
       break;
 
     case REGDIR:
       indexS = getRegIndex(instruction.regS);
       if(indexS == -1){
         addInterrupt();
-      } else {
-        reg[7] = reg[indexS];
+        return false;
       }
+      reg[7] = reg[indexS];
       break;
 
     case REGINDPOM:
       indexS = getRegIndex(instruction.regS);
       if(indexS == -1){
         addInterrupt();
-        break;
+        return false;
       }
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
 
       switch(instruction.addressUpdate){
         case NOUPD:
-          data = Memory[reg[indexS] + dataInt + 1] + Memory[reg[indexS] + dataInt];
+          data = readWord(reg[indexS] + dataInt);
           break;
 
         case DECBEFORE:
           reg[indexS] -= 2;
-          data = Memory[reg[indexS] + dataInt + 1] + Memory[reg[indexS] + dataInt];
+          data = readWord(reg[indexS] + dataInt);
           break;
 
         case INCBEFORE:
           reg[indexS] += 2;
-          data = Memory[reg[indexS] + dataInt + 1] + Memory[reg[indexS] + dataInt];
+          data = readWord(reg[indexS] + dataInt);
           break;
 
         case DECAFTER:
-          data = Memory[reg[indexS] + dataInt + 1] + Memory[reg[indexS] + dataInt];
+          data = readWord(reg[indexS] + dataInt);
           reg[indexS] -= 2;     
           break;
 
         case INCAFTER:
-          data = Memory[reg[indexS] + dataInt + 1] + Memory[reg[indexS] + dataInt];
+          data = readWord(reg[indexS] + dataInt);
           reg[indexS] += 2;         
           break; 
       }
-      reg[7]= stoul(data, nullptr, 16); 
+      reg[7] = data; 
       break;
 
     case MEMDIR:
-      data = Memory[dataInt + 1] + Memory[dataInt];
-      ss << data;
-      ss >> hex >> reg[7];
+      reg[7] = readWord(dataInt);
       break;
 
     case REGDIRPOM:
       indexS = getRegIndex(instruction.regS);
       if(indexS == -1){
         addInterrupt();
-        break;
+        return false;
       }
-      data = instruction.dataHigh + instruction.dataLow;
-
-      if(data[0] == '8' || data[0] == '9' || data[0] == 'A' || data[0] == 'B' || data[0] == 'C' || data[0] == 'D' 
-      || data[0] == 'E' || data[0] == 'F') 
-        data  = "FFFF" + data;
-
-      ss << data;
-      ss >> hex >> dataInt;
+      dataInt = (short)dataInt;   // displacement is signed
       reg[7] = dataInt + reg[indexS];
       break;
 
@@ -476,41 +763,45 @@ void Emulator::PCJumpChange(){
       indexS = getRegIndex(instruction.regS);
       if(indexS == -1){
         addInterrupt();
-        break;
+        return false;
       }
       switch(instruction.addressUpdate){
         case NOUPD:
-          data = Memory[reg[indexS] + 1] + Memory[reg[indexS]];
+          data = readWord(reg[indexS]);
           break;
 
         case DECBEFORE:
           reg[indexS] -= 2;
-          data = Memory[reg[indexS] + 1] + Memory[reg[indexS]];
+          data = readWord(reg[indexS]);
           break;
 
         case INCBEFORE:
           reg[indexS] += 2;
-          data = Memory[reg[indexS] + 1] + Memory[reg[indexS]];
+          data = readWord(reg[indexS]);
+          break;
 
         case DECAFTER:
-          data = Memory[reg[indexS] + 1] + Memory[reg[indexS]];
+          data = readWord(reg[indexS]);
           reg[indexS] -= 2;     
           break;
 
         case INCAFTER:
-          data = Memory[reg[indexS] + 1] + Memory[reg[indexS]];
+          data = readWord(reg[indexS]);
           reg[indexS] += 2;         
           break; 
       }
-      ss << data;
-      ss >> hex >> reg[7];
+      reg[7] = data;
 
       break;
 
     default: /// TODO add Interrupt for ERRORTYPE
       addInterrupt();
-      break;
+      return false;
   }
+
+  // backward jump can close idle loop, blocks are checked by emulateBlocks() when whole block is executed
+  if(reg[7] < next && options.idleSkip && options.dispatch != BLOCK) checkIdle();
+  return true;
 }
 
 /**
@@ -533,20 +824,12 @@ void Emulator::_int(){
   } else {
     // stack part
     reg[6] -= 2;
-    // Memory[reg[6]] = psw; // TODO
-    vector<string> helper = decToCode(to_string(reg[7]));
-    Memory[reg[6] + 1] = helper[0];
-    Memory[reg[6]] = helper[1];
+    writeWord(reg[6], reg[7]);
 
     reg[6] -= 2;
-    helper = decToCode(to_string(reg[8]));
-    Memory[reg[6] + 1] = helper[0];
-    Memory[reg[6]] = helper[1];
+    writeWord(reg[6], reg[8]);
     
-    string help = Memory[(reg[indexD] % 8) * 2 + 1] + Memory[(reg[indexD] % 8) * 2];
-    stringstream ss;
-    ss << help;
-    ss >> hex >> reg[7];
+    reg[7] = readWord((reg[indexD] % 8) * 2);
   }
   
 }
@@ -557,15 +840,10 @@ void Emulator::_int(){
  */
 void Emulator::_iret(){ // TODO check
 
-  string help1 = Memory[reg[6] + 1] + Memory[reg[6]];
+  reg[8] = readWord(reg[6]);  // TODO check psw
   reg[6] += 2;
 
-  stringstream ss;
-  ss << help1;
-  ss >> hex >> reg[8];  // TODO check psw
-
-  string help2 = Memory[reg[6] + 1] + Memory[reg[6]];
-  reg[7] = stoul(help2, nullptr, 16);  
+  reg[7] = readWord(reg[6]);  
   reg[6] += 2;
 
 }
@@ -577,13 +855,10 @@ void Emulator::_iret(){ // TODO check
 void Emulator::_call(){
 
   reg[6]-=2;
-  string pc = to_string(reg[7]);
-  vector<string> helper = decToCode(pc);
-
-  Memory[reg[6]] = helper[1];               // TODO check
-  Memory[reg[6] + 1] = helper[0];
+  writeWord(reg[6], reg[7]);
 
-  PCJumpChange();
+  // rejected target raises error interrupt, such call is never matched by ret so it isn't profiled
+  if(PCJumpChange() && options.profile) profileCall(readWord(reg[6]) - instruction.size);
 }
 
 /**
@@ -591,12 +866,9 @@ void Emulator::_call(){
  * 
  */
 void Emulator::_ret(){
-  string help1 = Memory[reg[6] + 1] + Memory[reg[6]];
+  reg[7] = readWord(reg[6]);
   reg[6] += 2;
-
-  stringstream ss;
-  ss << help1;
-  ss >> hex >> reg[7];
+  if(options.profile) profileReturn();
 }
 
 /**
@@ -883,15 +1155,11 @@ void Emulator::_load(){ //
     return;
   }
 
-  stringstream ss;
-  string data, dataLow, dataHigh;
-  int dataInt;
+  unsigned int data, dataInt = getInstructionData();
   switch(instruction.addressType){
 
     case IMMED:
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> reg[regDIndex];
+      reg[regDIndex] = dataInt;
       break;
 
     case REGDIR:
@@ -903,10 +1171,6 @@ void Emulator::_load(){ //
       break;
 
     case REGINDPOM:
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
-
       if(regSIndex == -1){
         addInterrupt();
         break;
@@ -914,40 +1178,34 @@ void Emulator::_load(){ //
 
       switch(instruction.addressUpdate){
         case NOUPD:
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          data = readWord(reg[regSIndex] + dataInt);
           break;
 
         case DECBEFORE:
           reg[regSIndex] -= 2;
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          data = readWord(reg[regSIndex] + dataInt);
           break;
 
         case INCBEFORE:
           reg[regSIndex] += 2;
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          data = readWord(reg[regSIndex] + dataInt);
           break;
 
         case DECAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          data = readWord(reg[regSIndex] + dataInt);
           reg[regSIndex] -= 2;     
           break;
 
         case INCAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          data = readWord(reg[regSIndex] + dataInt);
           reg[regSIndex] += 2;         
           break; 
       }
-      reg[regDIndex]= stoul(data, nullptr, 16); 
+      reg[regDIndex] = data; 
       break;
 
     case MEMDIR:
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
-      data = Memory[dataInt + 1] + Memory[dataInt];
-      reg[regDIndex] = stoul(data, nullptr, 16);
+      reg[regDIndex] = readWord(dataInt);
       break;
 
     case REGDIRPOM:
@@ -955,9 +1213,6 @@ void Emulator::_load(){ //
         addInterrupt();
         break;
       }
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
       reg[regDIndex] = dataInt + reg[regSIndex];
       break;
 
@@ -968,33 +1223,30 @@ void Emulator::_load(){ //
       }
       switch(instruction.addressUpdate){
         case NOUPD:
-          data = Memory[reg[regSIndex] + 1] + Memory[reg[regSIndex]];
+          data = readWord(reg[regSIndex]);
           break;
 
         case DECBEFORE:
           reg[regSIndex] -= 2;
-          data = Memory[reg[regSIndex] + 1] + Memory[reg[regSIndex]];
+          data = readWord(reg[regSIndex]);
           break;
 
         case INCBEFORE:
           reg[regSIndex] += 2;
-          data = Memory[reg[regSIndex]+ 1] + Memory[reg[regSIndex]];
+          data = readWord(reg[regSIndex]);
           break;
 
         case DECAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] +1] + Memory[reg[regSIndex]];
+          data = readWord(reg[regSIndex]);
           reg[regSIndex] -= 2;     
           break;
 
         case INCAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] + 1] + Memory[reg[regSIndex]];
+          data = readWord(reg[regSIndex]);
           reg[regSIndex] += 2;         
           break; 
       }
-      ss << data;
-      ss >> hex >> reg[regDIndex];
+      reg[regDIndex] = data;
       break;
 
     default: /// TODO add Interrupt for ERRORTYPE
@@ -1019,10 +1271,7 @@ void Emulator::_store(){  // TODO
     return;
   }
 
-  stringstream ss;
-  string data, dataLow, dataHigh;
-  int dataInt;
-  vector<string> helper;
+  unsigned int dataInt = getInstructionData();
 
   switch(instruction.addressType){
     case REGDIR:
@@ -1038,53 +1287,36 @@ void Emulator::_store(){  // TODO
         addInterrupt();
         break;
       }
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
 
       switch(instruction.addressUpdate){
         case NOUPD:
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          writeWord(reg[regSIndex] + dataInt, reg[regDIndex]);
           break;
 
         case DECBEFORE:
           reg[regSIndex] -= 2;
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          writeWord(reg[regSIndex] + dataInt, reg[regDIndex]);
           break;
 
         case INCBEFORE:
           reg[regSIndex] += 2;
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          writeWord(reg[regSIndex] + dataInt, reg[regDIndex]);
           break;
 
         case DECAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          writeWord(reg[regSIndex] + dataInt, reg[regDIndex]);
           reg[regSIndex] -= 2;     
           break;
 
         case INCAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          data = Memory[reg[regSIndex] + dataInt + 1] + Memory[reg[regSIndex] + dataInt];
+          writeWord(reg[regSIndex] + dataInt, reg[regDIndex]);
           reg[regSIndex] += 2;         
           break; 
       }
-      ss << data;
-      ss >> hex >> dataInt;
-
-      helper = decToCode(to_string(reg[regDIndex]));
-      Memory[dataInt + 1] = helper[0];
-      Memory[dataInt] = helper[1];
-
       break;
 
     case MEMDIR:
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
-      helper = decToCode(to_string(reg[regDIndex]));
-      Memory[dataInt + 1] = helper[0];
-      Memory[dataInt] = helper[1];
+      writeWord(dataInt, reg[regDIndex]);
       break;
 
     case REGDIRPOM:
@@ -1092,9 +1324,6 @@ void Emulator::_store(){  // TODO
         addInterrupt();
         break;
       }
-      data = instruction.dataHigh + instruction.dataLow;
-      ss << data;
-      ss >> hex >> dataInt;
       reg[regSIndex] = dataInt + reg[regDIndex];
       break;
 
@@ -1106,38 +1335,26 @@ void Emulator::_store(){  // TODO
 
       switch(instruction.addressUpdate){
         case NOUPD:
-          helper = decToCode(to_string(reg[regDIndex]));
-          Memory[reg[regSIndex] + 1] = helper[0];
-          Memory[reg[regSIndex]] = helper[1];
+          writeWord(reg[regSIndex], reg[regDIndex]);
           break;
 
         case DECBEFORE:
           reg[regSIndex] -= 2;
-          helper = decToCode(to_string(reg[regDIndex]));
-          Memory[reg[regSIndex]+ 1] = helper[0];
-          Memory[reg[regSIndex]] = helper[1];
+          writeWord(reg[regSIndex], reg[regDIndex]);
           break;
 
         case INCBEFORE:
           reg[regSIndex] += 2;
-          helper = decToCode(to_string(reg[regDIndex]));
-          Memory[reg[regSIndex]+ 1] = helper[0];
-          Memory[reg[regSIndex]] = helper[1];
+          writeWord(reg[regSIndex], reg[regDIndex]);
           break;
 
         case DECAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          helper = decToCode(to_string(reg[regDIndex]));
-          Memory[reg[regSIndex]+ 1] = helper[0];
-          Memory[reg[regSIndex]] = helper[1];
+          writeWord(reg[regSIndex], reg[regDIndex]);
           reg[regSIndex] -= 2;     
           break;
 
         case INCAFTER:
-          // reg[7] = Memory[reg[indexS] + dataInt];
-          helper = decToCode(to_string(reg[regDIndex]));
-          Memory[reg[regSIndex]+ 1] = helper[0];
-          Memory[reg[regSIndex]] = helper[1];
+          writeWord(reg[regSIndex], reg[regDIndex]);
           reg[regSIndex] += 2;         
           break; 
       }
@@ -1152,30 +1369,35 @@ void Emulator::_store(){  // TODO
 }
 
 /**
- * @brief sets Emulator::instruction to set instruction from reading
+ * @brief Decodes instruction that starts at given address
  * 
+ * @param address address of first instruction byte
+ * @param instruction record that is filled, fields that instruction doesn't use keep default values
  */
-void Emulator::getInstruction(){
+void Emulator::decodeInstruction(unsigned int address, Instruction& instruction){
+
+  instruction = Instruction();
 
-  string byte1 = Memory[reg[7]];
-  instruction.operation = getOPCode(byte1[0]);
+  uint8_t byte1 = Memory[address & ADDRESS_MASK];
+  instruction.opcode = byte1;
+  instruction.operation = getOPCode(byte1 >> 4);
   instruction.size = 1;
 
   // if here is 1B instruction nothing happens
   if(instruction.operation != HALT && instruction.operation != IRET && instruction.operation != RET){
-    string regs = Memory[reg[7] + 1];
-    instruction.regD = getRegister(regs[0]);
-    instruction.regS = getRegister(regs[1]);
+    uint8_t regs = Memory[(address + 1) & ADDRESS_MASK];
+    instruction.regD = getRegister(regs >> 4);
+    instruction.regS = getRegister(regs & 0xF);
     instruction.size++;
 
     // here it is 3B or 5B instruction
     if(instruction.operation != INT && instruction.operation != XCHG && instruction.operation != ARITHMETIC && instruction.operation != LOGIC 
     && instruction.operation != SHIFT && instruction.operation != ERROROP){
-      string addrTyp = Memory[reg[7] + 2];
-      instruction.addressType = getAddressType(addrTyp[1]);
+      uint8_t addrTyp = Memory[(address + 2) & ADDRESS_MASK];
+      instruction.addressType = getAddressType(addrTyp & 0xF);
 
       if(instruction.addressType == REGIND || instruction.addressType == REGINDPOM){
-        instruction.addressUpdate = getAddressUpdate(addrTyp[0]);
+        instruction.addressUpdate = getAddressUpdate(addrTyp >> 4);
       } else {
         instruction.addressUpdate = NOUPD;
       }
@@ -1185,7 +1407,7 @@ void Emulator::getInstruction(){
       instruction.shift = NOTSHIFT;
 
       if(instruction.operation == JUMP){
-        instruction.jump = getJumpInstr(byte1[1]);
+        instruction.jump = getJumpInstr(byte1 & 0xF);
       } else {
         if(instruction.operation == LOAD || instruction.operation == STORE || instruction.operation == CALL){
           instruction.jump = NOTJMP;
@@ -1195,8 +1417,7 @@ void Emulator::getInstruction(){
       if(instruction.addressType == MEMDIR || instruction.addressType == REGINDPOM || instruction.addressType == IMMED 
       || instruction.addressType == REGDIRPOM){
         instruction.size = 5;
-        instruction.dataHigh = Memory[reg[7] + 3];
-        instruction.dataLow = Memory[reg[7] + 4];
+        instruction.data = (Memory[(address + 3) & ADDRESS_MASK] << 8) | Memory[(address + 4) & ADDRESS_MASK];
       } else {
         instruction.size = 3;
       }
@@ -1221,7 +1442,7 @@ void Emulator::getInstruction(){
           break;
 
         case ARITHMETIC:
-          instruction.arithemtic = getArithmeticInstr(byte1[1]);
+          instruction.arithemtic = getArithmeticInstr(byte1 & 0xF);
           instruction.logic = NOTLOGIC;
           instruction.shift = NOTSHIFT;
           instruction.jump = NOTJMP;
@@ -1229,7 +1450,7 @@ void Emulator::getInstruction(){
 
         case LOGIC:
           instruction.arithemtic = NOTARITHMETIC;
-          instruction.logic = getLogicInstr(byte1[1]);
+          instruction.logic = getLogicInstr(byte1 & 0xF);
           instruction.shift = NOTSHIFT;
           instruction.jump = NOTJMP;
           break;
@@ -1237,12 +1458,15 @@ void Emulator::getInstruction(){
         case SHIFT:
           instruction.arithemtic = NOTARITHMETIC;
           instruction.logic = NOTLOGIC;
-          instruction.shift = getShiftInstr(byte1[1]);
+          instruction.shift = getShiftInstr(byte1 & 0xF);
           instruction.jump = NOTJMP;
           break;
 
         case ERROROP:
           break;
+
+        default:  // 3B and 5B operations are decoded above
+          break;
       }
 
     }
@@ -1250,6 +1474,32 @@ void Emulator::getInstruction(){
 
 }
 
+/**
+ * @brief sets Emulator::instruction to instruction at PC, decoding it only on first execution
+ * 
+ */
+void Emulator::getInstruction(){
+
+  unsigned int pc = reg[7] & ADDRESS_MASK;
+  if(!instructionCacheValid[pc]){
+    decodeInstruction(pc, instructionCache[pc]);
+    instructionCacheValid[pc] = true;
+  }
+  instruction = instructionCache[pc];
+}
+
+/**
+ * @brief Drops decoded instructions that contain bytes of the word at address
+ * 
+ * @param address address of the written word
+ */
+void Emulator::invalidateInstructionCache(unsigned int address){
+  // instruction that starts up to 4 bytes before the word can overlap it
+  for(unsigned int i = address - 4; i != address + 2; i++){
+    instructionCacheValid[i & ADDRESS_MASK] = false;
+  }
+}
+
 /**
  * @brief Executes set instruction
  * 
@@ -1404,13 +1654,10 @@ void Emulator::execute(){
 }
 
 /**
- * @brief Executes interrupt
+ * @brief Executes interrupt, pushes pc and psw and masks maskable interrupts
  * 
  */
-void Emulator::executeInterrupt(Interrupt interrupt){
-
-  string data = Memory[interrupt.entry * 2 + 1] + Memory[interrupt.entry * 2];
-  stringstream ss;
+void Emulator::executeInterrupt(unsigned int entry){
 
   instruction.operation = STORE;
   instruction.regD = PC;
@@ -1422,74 +1669,859 @@ void Emulator::executeInterrupt(Interrupt interrupt){
   instruction.regD = PSW;
   execute();
 
-  ss << data;
-  ss >> dec >> reg[7];
+  reg[8] |= PSW_I;      // handler isn't interrupted by maskable interrupts, iret restores psw
+  reg[7] = readWord(entry * 2);
 
 }
 
 /**
- * @brief emulates interrupt
+ * @brief Accepts pending interrupt that isn't masked, lower IVT entry has higher priority
+ * 
+ */
+void Emulator::acceptInterrupt(){
+
+  unsigned int ready = pendingInterrupts & unmaskedInterrupts();
+  if(ready == 0) return;
+
+#if defined(__GNUC__)
+  unsigned int entry = __builtin_ctz(ready);
+#else
+  unsigned int entry = 0;
+  while(!(ready & (1 << entry))) entry++;
+#endif
+
+  pendingInterrupts &= ~(1 << entry);
+  executeInterrupt(entry);
+}
+
+/**
+ * @brief Checks if interrupt() has work before next instruction, translated blocks leave early then
+ * so that events and interrupts are accepted after same instruction as in other engines
+ * 
+ * @return true device event is due or unmasked interrupt is pending
+ */
+bool Emulator::interruptDue(){
+  return cycles >= nextEventCycle || (pendingInterrupts && (pendingInterrupts & unmaskedInterrupts()));
+}
+
+/**
+ * @brief emulates interrupt, runs after every instruction so it only checks deadline of first device event
+ * and if anything is pending
  * 
  */
 void Emulator::interrupt(){
 
-  if(Interrupts.size() > 0){
+  if(cycles >= nextEventCycle) runEvents();
+  if(pendingInterrupts) acceptInterrupt();
+}
+
+/**
+ * @brief Returns which handler executes instruction with given first byte
+ * 
+ * @param opcode first instruction byte, operation code and modifier
+ * @return Emulator::HandlerId 
+ */
+Emulator::HandlerId Emulator::getHandlerId(uint8_t opcode){
+
+  switch(getOPCode(opcode >> 4)){
+    case HALT: return ID_HALT;
+    case INT: return ID_INT;
+    case IRET: return ID_IRET;
+    case CALL: return ID_CALL;
+    case RET: return ID_RET;
+    case XCHG: return ID_XCHG;
+    case LOAD: return ID_LOAD;
+    case STORE: return ID_STORE;
+
+    case JUMP:
+      switch(getJumpInstr(opcode & 0xF)){
+        case JMP: return ID_JMP;
+        case JEQ: return ID_JEQ;
+        case JNE: return ID_JNE;
+        case JGT: return ID_JGT;
+        default: return ID_ERROR;
+      }
+
+    case ARITHMETIC:
+      switch(getArithmeticInstr(opcode & 0xF)){
+        case ADD: return ID_ADD;
+        case SUB: return ID_SUB;
+        case MUL: return ID_MUL;
+        case DIV: return ID_DIV;
+        case CMP: return ID_CMP;
+        default: return ID_ERROR;
+      }
 
-    if(reg[8] | 32768){     // reg I == 1
-      executeInterrupt(Interrupts[0]);
-      Interrupts.erase(Interrupts.begin());
-    } else{
-      int ret = checkUnmaskedInterrupts();
-      if(ret != -1){          // there are unmasked interupts
-        executeInterrupt(Interrupts[ret]);
-        Interrupts.erase(Interrupts.begin() + ret);
+    case LOGIC:
+      switch(getLogicInstr(opcode & 0xF)){
+        case NOT: return ID_NOT;
+        case AND: return ID_AND;
+        case OR: return ID_OR;
+        case XOR: return ID_XOR;
+        case TEST: return ID_TEST;
+        default: return ID_ERROR;
       }
-    }
+
+    case SHIFT:
+      switch(getShiftInstr(opcode & 0xF)){
+        case SHL: return ID_SHL;
+        case SHR: return ID_SHR;
+        default: return ID_ERROR;
+      }
+
+    default:
+      return ID_ERROR;
   }
 }
 
 /**
- * @brief Emulation
+ * @brief Fills dispatch table so that every first instruction byte points straight to its handler
  * 
- * @return int 0 - everything is good, -1 input file doesn't exist
  */
-int Emulator::emulate(){
+void Emulator::setDispatchTable(){
+
+  Handler handlers[HANDLER_COUNT];
+  handlers[ID_HALT] = &Emulator::_halt;
+  handlers[ID_INT] = &Emulator::_int;
+  handlers[ID_IRET] = &Emulator::_iret;
+  handlers[ID_CALL] = &Emulator::_call;
+  handlers[ID_RET] = &Emulator::_ret;
+  handlers[ID_JMP] = &Emulator::_jmp;
+  handlers[ID_JEQ] = &Emulator::_jeq;
+  handlers[ID_JNE] = &Emulator::_jne;
+  handlers[ID_JGT] = &Emulator::_jgt;
+  handlers[ID_XCHG] = &Emulator::_xchg;
+  handlers[ID_ADD] = &Emulator::_add;
+  handlers[ID_SUB] = &Emulator::_sub;
+  handlers[ID_MUL] = &Emulator::_mul;
+  handlers[ID_DIV] = &Emulator::_div;
+  handlers[ID_CMP] = &Emulator::_cmp;
+  handlers[ID_NOT] = &Emulator::_not;
+  handlers[ID_AND] = &Emulator::_and;
+  handlers[ID_OR] = &Emulator::_or;
+  handlers[ID_XOR] = &Emulator::_xor;
+  handlers[ID_TEST] = &Emulator::_test;
+  handlers[ID_SHL] = &Emulator::_shl;
+  handlers[ID_SHR] = &Emulator::_shr;
+  handlers[ID_LOAD] = &Emulator::_load;
+  handlers[ID_STORE] = &Emulator::_store;
+  handlers[ID_ERROR] = &Emulator::_error;
+
+  for(int i = 0; i < 256; i++){
+    dispatchTable[i] = handlers[getHandlerId(i)];
+  }
+}
 
-  if(!openFile()) return -1;
-  loadMemory();
+/**
+ * @brief Emulate instruction with unknown operation code
+ * 
+ */
+void Emulator::_error(){
+  addInterrupt();
+}
 
-  string startPC = Memory[1] + Memory[0];
-  stringstream ss;
-  ss << startPC;
-  ss >> hex >> reg[7];
+/**
+ * @brief Writes current instruction and registers to trace
+ * 
+ */
+void Emulator::traceInstruction(){
 
-  ofstream helperStream;
-  helperStream.open("helper.emulator.hex", ios::out|ios::trunc);
+  unsigned int pc = reg[7] & ADDRESS_MASK;
+  if(pc < options.traceStart || pc >= options.traceEnd) return;
+  if(++traceCounter < options.traceEvery) return;
+  traceCounter = 0;
 
-  while(true){
+  if(options.traceBinary){
+    traceRecord(pc);
+    return;
+  }
+
+  // no endl here, stream is flushed only when its buffer is full
+  traceStream << toStringOPCode() << "\t" << toStringAddressType() << "\t" << toStringAddressUpdate() << " RegD " << toStringRegister(instruction.regD) 
+  << "\tRegS " << toStringRegister(instruction.regS)  << "\t" << hex << uppercase << setfill('0') << setw(4) << instruction.data << dec << '\n';
+
+  for(int i = 0; i < 9; i++){
+    traceStream << "R[" << i << "]:\t" << reg[i] << "\t\t";
+    if(i % 3 == 2) traceStream << '\n';
+  }
+  traceStream << "\n\n";
+}
+
+/**
+ * @brief Opens trace file with large user-space buffer
+ * 
+ */
+void Emulator::openTrace(){
+
+  if(options.traceFile == "") options.traceFile = options.traceBinary ? "helper.emulator.trace" : "helper.emulator.hex";
+
+  traceCounter = 0;
+  if(options.traceBinary){
+    traceStream.open(options.traceFile, ios::out|ios::trunc|ios::binary);
+
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    traceStream.write((const char*)&header, sizeof(header));
+
+    traceRecords.reserve(TRACE_RECORDS);
+    for(int i = 0; i < 9; i++) traceRegisters[i] = 0;
+  } else {
+    traceBuffer.resize(TRACE_BUFFER_SIZE);
+    traceStream.rdbuf()->pubsetbuf(traceBuffer.data(), traceBuffer.size());
+    traceStream.open(options.traceFile, ios::out|ios::trunc);
+  }
+}
+
+/**
+ * @brief Writes records that are left and closes trace file
+ * 
+ */
+void Emulator::closeTrace(){
+  if(options.traceBinary) flushTraceRecords();
+  traceStream.close();
+}
+
+/**
+ * @brief Writes all collected binary records at once
+ * 
+ */
+void Emulator::flushTraceRecords(){
+  traceStream.write((const char*)traceRecords.data(), traceRecords.size() * sizeof(TraceRecord));
+  traceRecords.clear();
+}
+
+/**
+ * @brief Adds binary record for current instruction, registers are stored as deltas
+ * 
+ * @param pc address of current instruction
+ */
+void Emulator::traceRecord(unsigned int pc){
+
+  TraceRecord record;
+  memset(&record, 0, sizeof(record));
+  record.pc = pc;
+  record.changed[0] = record.changed[1] = TRACE_NO_REGISTER;
 
-    getInstruction();
-    helperStream << toStringOPCode() << "\t" << toStringAddressType() << "\t" << toStringAddressUpdate() << " RegD " << toStringRegister(instruction.regD) 
-    << "\tRegS " << toStringRegister(instruction.regS)  << "\t" << instruction.dataHigh << instruction.dataLow << endl;
+  traceRegisters[7] = pc;   // decoder sets PC from record
+  int changed = 0;
+  for(int i = 0; i < 9; i++){
+    if(reg[i] == traceRegisters[i]) continue;
 
-    for(int i = 0; i < 9; i++){
-      helperStream << "R[" << i << "]:\t" << reg[i] << "\t\t";
-      if(i % 3 == 2) helperStream << endl;
+    if(changed == 2){         // no more slots, this one only carries deltas
+      traceRecords.push_back(record);
+      record.changed[0] = record.changed[1] = TRACE_NO_REGISTER;
+      changed = 0;
     }
-    helperStream << endl << endl;
-    reg[7] += instruction.size;
+    record.changed[changed] = i;
+    record.value[changed] = reg[i];
+    traceRegisters[i] = reg[i];
+    changed++;
+  }
+
+  record.size = instruction.size;
+  for(int i = 0; i < instruction.size; i++){
+    record.code[i] = Memory[(pc + i) & ADDRESS_MASK];
+  }
+  traceRecords.push_back(record);
+
+  if(traceRecords.size() >= TRACE_RECORDS) flushTraceRecords();
+}
+
+/**
+ * @brief Loads symbol map written by linker with -map, every line is "<hex address> <name>"
+ * 
+ * @return true map is loaded
+ * @return false map doesn't exist
+ */
+bool Emulator::loadSymbolMap(){
+
+  ifstream map(options.symbolFile, ios::in);
+  if(!map.is_open()) return false;
+
+  unsigned int address;
+  string name;
+  while(map >> hex >> address >> name){
+    symbolMap.push_back({address & ADDRESS_MASK, name});
+  }
+  stable_sort(symbolMap.begin(), symbolMap.end(),
+    [](const pair<unsigned int, string>& a, const pair<unsigned int, string>& b){ return a.first < b.first; });
+
+  return true;
+}
+
+/**
+ * @brief Returns index in symbol map of symbol that address belongs to, last symbol at or before address
+ * 
+ * @param address address
+ * @return int -1 there is no symbol before address
+ */
+int Emulator::findSymbol(unsigned int address){
+  auto it = upper_bound(symbolMap.begin(), symbolMap.end(), address,
+    [](unsigned int a, const pair<unsigned int, string>& sym){ return a < sym.first; });
+  return it - symbolMap.begin() - 1;
+}
+
+/**
+ * @brief Returns address as symbol+offset, or as hex number if there is no symbol before it
+ * 
+ * @param address address
+ * @return string name of address
+ */
+string Emulator::symbolName(unsigned int address){
+
+  stringstream name;
+  int i = findSymbol(address);
+  if(i == -1){
+    name << "0x" << hex << setfill('0') << setw(4) << address;
+  } else {
+    name << symbolMap[i].second;
+    if(address != symbolMap[i].first) name << "+0x" << hex << address - symbolMap[i].first;
+  }
+  return name.str();
+}
+
+/**
+ * @brief Counts call from call site to current PC and opens frame for inclusive cycles of callee
+ * 
+ * @param site address of call instruction
+ */
+void Emulator::profileCall(unsigned int site){
+
+  unsigned int target = reg[7] & ADDRESS_MASK;
+  profileTargets[target].calls++;
+  profileEdges[(site & ADDRESS_MASK) << 16 | target]++;
+  profileStack.push_back({target, cycles});
+}
+
+/**
+ * @brief Closes frame of last call, return without call (e.g. from interrupt routine) is ignored
+ * 
+ */
+void Emulator::profileReturn(){
+
+  if(profileStack.empty()) return;
+  ProfileFrame frame = profileStack.back();
+  profileStack.pop_back();
+  profileTargets[frame.target].inclusive += cycles - frame.startCycle;
+}
+
+/**
+ * @brief Writes flat profile by symbol and by address and call graph, counts are instructions retired
+ * 
+ */
+void Emulator::writeProfile(){
+
+  if(options.profileFile == "") options.profileFile = "helper.emulator.profile";
+  ofstream out(options.profileFile, ios::out|ios::trunc);
+
+  unsigned long long retired = 0;
+  vector<unsigned long long> symbolCounts(symbolMap.size(), 0);
+  unsigned long long unknown = 0;                 // instructions before first symbol
+  vector<unsigned int> addresses;
+  for(unsigned int pc = 0; pc < MEMORY_SIZE; pc++){
+    if(profileCounts[pc] == 0) continue;
+    retired += profileCounts[pc];
+    addresses.push_back(pc);
+
+    int i = findSymbol(pc);
+    if(i == -1) unknown += profileCounts[pc];
+    else symbolCounts[i] += profileCounts[pc];
+  }
+
+  out << "Cycles: " << cycles << "\tinstructions: " << retired << "\tskipped in idle loops: " << cycles - retired
+    << "\n\n";
+  out << fixed << setprecision(2);
+
+  out << "Flat profile by symbol\n";
+  out << "instructions\t%\tcalls\tinclusive cycles\tsymbol\n";
+  vector<int> symbols;
+  for(size_t i = 0; i < symbolMap.size(); i++){
+    if(findSymbol(symbolMap[i].first) != (int)i) continue;    // address is named after other symbol (e.g. section)
+    if(symbolCounts[i] > 0 || profileTargets.count(symbolMap[i].first)) symbols.push_back(i);
+  }
+  stable_sort(symbols.begin(), symbols.end(), [&symbolCounts](int a, int b){ return symbolCounts[a] > symbolCounts[b]; });
+  for(int i: symbols){
+    auto target = profileTargets.find(symbolMap[i].first);
+    out << symbolCounts[i] << "\t" << (retired ? 100.0 * symbolCounts[i] / retired : 0) << "\t";
+    if(target != profileTargets.end()) out << target->second.calls << "\t" << target->second.inclusive;
+    else out << "-\t-";
+    out << "\t" << symbolMap[i].second << "\n";
+  }
+  if(unknown > 0) out << unknown << "\t" << 100.0 * unknown / retired << "\t-\t-\t<no symbol>\n";
+
+  out << "\nFlat profile by address\n";
+  out << "instructions\t%\taddress\tsymbol\n";
+  stable_sort(addresses.begin(), addresses.end(), [this](unsigned int a, unsigned int b){ 
+    return profileCounts[a] > profileCounts[b];
+  });
+  for(unsigned int pc: addresses){
+    out << profileCounts[pc] << "\t" << 100.0 * profileCounts[pc] / retired << "\t" << hex << setfill('0') << setw(4) << pc 
+      << dec << "\t" << symbolName(pc) << "\n";
+  }
+
+  out << "\nCall graph\n";
+  out << "calls\tcaller\tcall site\tcallee\n";
+  vector<pair<unsigned int, unsigned long long>> edges(profileEdges.begin(), profileEdges.end());
+  sort(edges.begin(), edges.end(), [](const pair<unsigned int, unsigned long long>& a, 
+    const pair<unsigned int, unsigned long long>& b){
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  for(const auto& edge: edges){
+    unsigned int site = edge.first >> 16, target = edge.first & ADDRESS_MASK;
+    int caller = findSymbol(site);
+    out << edge.second << "\t" << (caller == -1 ? "<no symbol>" : symbolMap[caller].second) << "\t" << symbolName(site)
+      << "\t" << symbolName(target) << "\n";
+  }
+}
+
+/**
+ * @brief Fetches instruction at PC, writes it to trace and moves PC to next instruction
+ * 
+ */
+void Emulator::fetch(){
+
+  getInstruction();
+  if(options.trace) traceInstruction();
+  if(options.profile) profileCounts[reg[7] & ADDRESS_MASK]++;
+  reg[7] += instruction.size;
+}
+
+/**
+ * @brief Same as fetch() for instruction that is already decoded, used by translated blocks,
+ * cycle is counted here so that fused op counts only instructions that really started
+ * 
+ * @param ins decoded instruction at PC
+ */
+void Emulator::startInstruction(const Instruction& ins){
+
+  instruction = ins;
+  cycles++;
+  if(options.trace) traceInstruction();
+  if(options.profile) profileCounts[reg[7] & ADDRESS_MASK]++;
+  reg[7] += ins.size;
+}
+
+/**
+ * @brief Main loop that walks nested switch in execute()
+ * 
+ */
+void Emulator::emulateSwitch(){
+
+  while(true){
+
+    fetch();
 
     if(instruction.operation == ERROROP){
       addInterrupt();
     } else {
       execute();
     }
+    cycles++;
+
+    if(stop){
+      break;
+    }
+    interrupt();
+  }
+}
+
+/**
+ * @brief Main loop that calls handler from dispatch table indexed by first instruction byte
+ * 
+ */
+void Emulator::emulateTable(){
+
+  while(true){
+
+    fetch();
+    (this->*dispatchTable[instruction.opcode])();
+    cycles++;
+
+    if(stop){
+      break;
+    }
+    interrupt();
+  }
+}
+
+/**
+ * @brief Main loop with computed goto, every handler jumps straight to next one
+ * 
+ */
+void Emulator::emulateThreaded(){
+
+#if defined(__GNUC__)
+  void* handlerLabels[HANDLER_COUNT];
+  handlerLabels[ID_HALT] = &&halt;
+  handlerLabels[ID_INT] = &&int_;
+  handlerLabels[ID_IRET] = &&iret;
+  handlerLabels[ID_CALL] = &&call;
+  handlerLabels[ID_RET] = &&ret;
+  handlerLabels[ID_JMP] = &&jmp;
+  handlerLabels[ID_JEQ] = &&jeq;
+  handlerLabels[ID_JNE] = &&jne;
+  handlerLabels[ID_JGT] = &&jgt;
+  handlerLabels[ID_XCHG] = &&xchg;
+  handlerLabels[ID_ADD] = &&add;
+  handlerLabels[ID_SUB] = &&sub;
+  handlerLabels[ID_MUL] = &&mul;
+  handlerLabels[ID_DIV] = &&div;
+  handlerLabels[ID_CMP] = &&cmp;
+  handlerLabels[ID_NOT] = &&not_;
+  handlerLabels[ID_AND] = &&and_;
+  handlerLabels[ID_OR] = &&or_;
+  handlerLabels[ID_XOR] = &&xor_;
+  handlerLabels[ID_TEST] = &&test;
+  handlerLabels[ID_SHL] = &&shl;
+  handlerLabels[ID_SHR] = &&shr;
+  handlerLabels[ID_LOAD] = &&load;
+  handlerLabels[ID_STORE] = &&store;
+  handlerLabels[ID_ERROR] = &&error;
+
+  void* labels[256];
+  for(int i = 0; i < 256; i++){
+    labels[i] = handlerLabels[getHandlerId(i)];
+  }
+
+#define DISPATCH() fetch(); goto *labels[instruction.opcode]
+#define NEXT() cycles++; if(stop) return; interrupt(); DISPATCH()
+
+  DISPATCH();
+
+  halt: _halt(); NEXT();
+  int_: _int(); NEXT();
+  iret: _iret(); NEXT();
+  call: _call(); NEXT();
+  ret: _ret(); NEXT();
+  jmp: _jmp(); NEXT();
+  jeq: _jeq(); NEXT();
+  jne: _jne(); NEXT();
+  jgt: _jgt(); NEXT();
+  xchg: _xchg(); NEXT();
+  add: _add(); NEXT();
+  sub: _sub(); NEXT();
+  mul: _mul(); NEXT();
+  div: _div(); NEXT();
+  cmp: _cmp(); NEXT();
+  not_: _not(); NEXT();
+  and_: _and(); NEXT();
+  or_: _or(); NEXT();
+  xor_: _xor(); NEXT();
+  test: _test(); NEXT();
+  shl: _shl(); NEXT();
+  shr: _shr(); NEXT();
+  load: _load(); NEXT();
+  store: _store(); NEXT();
+  error: _error(); NEXT();
+
+#undef NEXT
+#undef DISPATCH
+#else
+  emulateTable();     // no labels as values, table dispatch is the closest
+#endif
+}
+
+/**
+ * @brief Checks if instruction is the last one in basic block
+ * 
+ * @param ins decoded instruction
+ * @return true instruction changes control flow or stops the processor
+ * @return false execution continues with next instruction
+ */
+bool Emulator::endsBlock(const Instruction& ins){
+  return ins.operation == JUMP || ins.operation == CALL || ins.operation == RET || ins.operation == IRET || ins.operation == INT 
+    || ins.operation == HALT || ins.operation == ERROROP;
+}
+
+/**
+ * @brief Translates one instruction to closure, register indexes and operands are resolved here
+ * 
+ * @param ins decoded instruction
+ * @param op translated operation that is filled
+ */
+void Emulator::translateInstruction(const Instruction& ins, TranslatedOp& op){
+
+  int d = getRegIndex(ins.regD);
+  int s = getRegIndex(ins.regS);
+  unsigned int value = ins.data;
+
+  op.run = [this, ins](){ startInstruction(ins); (this->*dispatchTable[ins.opcode])(); };
+
+  switch(getHandlerId(ins.opcode)){
+    case ID_ADD:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] += reg[s]; };
+      break;
+
+    case ID_SUB:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] -= reg[s]; };
+      break;
+
+    case ID_MUL:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] *= reg[s]; };
+      break;
+
+    case ID_AND:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] &= reg[s]; };
+      break;
+
+    case ID_OR:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] |= reg[s]; };
+      break;
+
+    case ID_XOR:
+      if(d != -1 && s != -1) op.run = [this, ins, d, s](){ startInstruction(ins); reg[d] ^= reg[s]; };
+      break;
+
+    case ID_LOAD:
+      if(d == -1) break;
+      if(ins.addressType == IMMED){
+        op.run = [this, ins, d, value](){ startInstruction(ins); reg[d] = value; };
+      } else if(ins.addressType == MEMDIR){
+        op.run = [this, ins, d, value](){ startInstruction(ins); reg[d] = readWord(value); };
+      } else if(ins.addressType == REGINDPOM && ins.addressUpdate == NOUPD && s != -1){
+        op.run = [this, ins, d, s, value](){ startInstruction(ins); reg[d] = readWord(reg[s] + value); };
+      } else if(ins.addressType == REGIND && ins.addressUpdate == INCAFTER && s != -1){   // pop
+        op.run = [this, ins, d, s](){ 
+          startInstruction(ins);
+          unsigned int data = readWord(reg[s]);
+          reg[s] += 2;
+          reg[d] = data;
+        };
+      }
+      break;
+
+    case ID_STORE:
+      if(d == -1) break;
+      if(ins.addressType == MEMDIR){
+        op.run = [this, ins, d, value](){ startInstruction(ins); writeWord(value, reg[d]); };
+      } else if(ins.addressType == REGIND && ins.addressUpdate == DECBEFORE && s != -1){    // push
+        op.run = [this, ins, d, s](){ startInstruction(ins); reg[s] -= 2; writeWord(reg[s], reg[d]); };
+      }
+      break;
+
+    case ID_JMP:
+      if(ins.addressType == IMMED) op.run = [this, ins, value](){ startInstruction(ins); reg[7] = value; };
+      break;
+
+    case ID_JEQ:
+      if(ins.addressType == IMMED) op.run = [this, ins, value](){ startInstruction(ins); if(reg[8] & 1) reg[7] = value; };
+      break;
+
+    case ID_JNE:
+      if(ins.addressType == IMMED) op.run = [this, ins, value](){ startInstruction(ins); if(!(reg[8] & 1)) reg[7] = value; };
+      break;
+
+    case ID_CALL:
+      if(ins.addressType == IMMED){
+        op.run = [this, ins, value](){ 
+          startInstruction(ins);
+          reg[6] -= 2;
+          writeWord(reg[6], reg[7]);
+          reg[7] = value;     // immediate target can't be rejected, call is always profiled
+          if(options.profile) profileCall(readWord(reg[6]) - ins.size);
+        };
+      }
+      break;
+
+    case ID_RET:
+      op.run = [this, ins](){ 
+        startInstruction(ins);
+        reg[7] = readWord(reg[6]);
+        reg[6] += 2;
+        if(options.profile) profileReturn();
+      };
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Translates two neighbouring instructions to one closure when they form known pattern
+ * 
+ * @param first first instruction
+ * @param second instruction right after first
+ * @param op translated operation that is filled
+ * @return true instructions are fused
+ * @return false there is no pattern for these instructions
+ */
+bool Emulator::fuseInstructions(const Instruction& first, const Instruction& second, TranslatedOp& op){
+
+  HandlerId firstId = getHandlerId(first.opcode);
+  HandlerId secondId = getHandlerId(second.opcode);
+  int d = getRegIndex(first.regD);
+
+  // ldr rX, $literal; push rX
+  if(firstId == ID_LOAD && first.addressType == IMMED && d != -1 && secondId == ID_STORE && second.addressType == REGIND 
+  && second.addressUpdate == DECBEFORE && second.regD == first.regD && second.regS == SP){
+    unsigned int value = first.data;
+    op.run = [this, first, second, d, value](){
+      startInstruction(first);
+      reg[d] = value;
+      if(interruptDue()) return;     // event comes before push, like in other engines
+      startInstruction(second);
+      reg[6] -= 2;
+      writeWord(reg[6], reg[d]);
+    };
+    return true;
+  }
+
+  // cmp rX, rY; jeq/jne literal
+  if(firstId == ID_CMP && (secondId == ID_JEQ || secondId == ID_JNE) && second.addressType == IMMED){
+    unsigned int target = second.data;
+    bool equal = secondId == ID_JEQ;
+    op.run = [this, first, second, target, equal](){
+      startInstruction(first);
+      _cmp();
+      if(exitBlock || interruptDue()) return;     // interrupt or event comes before jump
+      startInstruction(second);
+      if(((reg[8] & 1) != 0) == equal) reg[7] = target;
+    };
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Translates basic block that starts at address
+ * 
+ * @param address address of first instruction in block
+ * @param block block that is filled
+ */
+void Emulator::translateBlock(unsigned int address, Block& block){
+
+  unsigned int pc = address;
+  block.start = address;
+  block.ops.clear();
+
+  while(true){
+    Instruction ins, next;
+    TranslatedOp op;
+    op.pc = pc;
+
+    decodeInstruction(pc, ins);
+    bool fused = false;
+    unsigned int size = ins.size;
+    if(!endsBlock(ins) && block.ops.size() + 1 < MAX_BLOCK_SIZE){
+      decodeInstruction(pc + ins.size, next);
+      fused = fuseInstructions(ins, next, op);
+      if(fused) size += next.size;
+    }
+    if(!fused) translateInstruction(ins, op);
+
+    for(unsigned int i = 0; i < size; i++){
+      translatedCode[(pc + i) & ADDRESS_MASK] = true;
+    }
+    pc += size;
+    block.ops.push_back(op);
+
+    if(endsBlock(fused ? next : ins) || block.ops.size() >= MAX_BLOCK_SIZE) break;
+  }
+
+  block.end = pc;
+}
+
+/**
+ * @brief Returns translated block that starts at address, translates it on first use
+ * 
+ * @param address address of first instruction in block
+ * @return Emulator::Block& 
+ */
+Emulator::Block& Emulator::getBlock(unsigned int address){
+
+  unordered_map<unsigned int, Block>::iterator found = blockCache.find(address);
+  if(found != blockCache.end()) return found->second;
+
+  Block& block = blockCache[address];
+  translateBlock(address, block);
+  return block;
+}
+
+/**
+ * @brief Drops all translated blocks, called after store into translated code
+ * 
+ */
+void Emulator::flushBlocks(){
+  blockCache.clear();
+  translatedCode.assign(MEMORY_SIZE, false);
+  blockCacheDirty = false;
+}
+
+/**
+ * @brief Main loop that executes whole translated blocks
+ * 
+ */
+void Emulator::emulateBlocks(){
+
+  exitBlock = false;
+  while(true){
+
+    Block& block = getBlock(reg[7] & ADDRESS_MASK);
+    for(TranslatedOp& op: block.ops){
+      op.run();
+      if(exitBlock || interruptDue()) break;    // interrupt, store into translated code or device event
+    }
+    if(reg[7] < block.end && options.idleSkip) checkIdle();     // block jumped back, can close idle loop
+
+    if(exitBlock){
+      exitBlock = false;
+      if(blockCacheDirty) flushBlocks();
+    }
 
     if(stop){
       break;
     }
     interrupt();
   }
+}
+
+/**
+ * @brief Emulation
+ * 
+ * @return int 0 - everything is good, -1 input file doesn't exist, -2 input file isn't valid memory image,
+ * -3 input file isn't valid hex file, -4 symbol map doesn't exist
+ */
+int Emulator::emulate(){
+
+  if(!openFile()) return -1;
+  if(options.symbolFile != "" && !loadSymbolMap()) return -4;
+  if(inputFileName.substr(inputFileName.find_last_of(".")+1) == "bin"){
+    if(!loadImage()) return -2;
+  } else {
+    if(!loadMemory()) return -3;
+    reg[7] = readWord(0);
+  }
+
+  startTimer();
+  startTerminal();
+  if(options.trace) openTrace();
+  if(options.profile) profileCounts.assign(MEMORY_SIZE, 0);
+
+  switch(options.dispatch){
+    case SWITCH:
+      emulateSwitch();
+      break;
+
+    case TABLE:
+      emulateTable();
+      break;
+
+    case THREADED:
+      emulateThreaded();
+      break;
+
+    case BLOCK:
+      emulateBlocks();
+      break;
+  }
+
+  stopTerminal();
+  if(options.trace) closeTrace();
+  if(options.profile) writeProfile();
 
   cout << "------------------------------------------------\n"
   << "Emulated processor executed halt instruction\n"
@@ -1516,15 +2548,103 @@ int Emulator::emulate(){
   return 0;
 }
 
+/**
+ * @brief Reads one command line option
+ * 
+ * @param option option as written in terminal
+ * @param options where read value is stored
+ * @return true option is good
+ * @return false option is unknown or has bad value
+ */
+bool checkOption(string option, Emulator::Options& options){
+
+  try{
+    if(option == "-trace"){
+      options.trace = true;
+      return true;
+    }
+    if(option == "-trace-binary"){
+      options.trace = true;
+      options.traceBinary = true;
+      return true;
+    }
+    if(option.compare(0, 7, "-trace=") == 0){
+      options.trace = true;
+      options.traceFile = option.substr(7);
+      return options.traceFile != "";
+    }
+    if(option.compare(0, 13, "-trace-range=") == 0){     // -trace-range=<start>:<end>, end is not traced
+      string range = option.substr(13);
+      size_t pos = range.find(":");
+      if(pos == string::npos) return false;
+      options.traceStart = stoul(range.substr(0, pos), nullptr, 0);
+      options.traceEnd = stoul(range.substr(pos + 1), nullptr, 0);
+      return options.traceStart < options.traceEnd;
+    }
+    if(option == "-profile"){
+      options.profile = true;
+      return true;
+    }
+    if(option.compare(0, 9, "-profile=") == 0){
+      options.profile = true;
+      options.profileFile = option.substr(9);
+      return options.profileFile != "";
+    }
+    if(option.compare(0, 9, "-symbols=") == 0){          // -symbols=<file>, symbol map from linker -map
+      options.symbolFile = option.substr(9);
+      return options.symbolFile != "";
+    }
+    if(option == "-terminal"){
+      options.terminal = true;
+      return true;
+    }
+    if(option == "-no-idle-skip"){
+      options.idleSkip = false;
+      return true;
+    }
+    if(option.compare(0, 13, "-trace-every=") == 0){     // -trace-every=<N>, every N-th instruction in range
+      options.traceEvery = stoul(option.substr(13), nullptr, 0);
+      return options.traceEvery > 0;
+    }
+  }
+  catch(const std::exception& e){   // bad number
+    return false;
+  }
+
+  if(option == "-dispatch=switch") options.dispatch = Emulator::SWITCH;
+  else if(option == "-dispatch=table") options.dispatch = Emulator::TABLE;
+  else if(option == "-dispatch=threaded") options.dispatch = Emulator::THREADED;
+  else if(option == "-dispatch=block") options.dispatch = Emulator::BLOCK;
+  else return false;
+
+  return true;
+}
+
 int main(int argc, char const *argv[]){
   try{
-    if(!argv[1]) throw InputException();
-    if(!checkInputData(argv[1])) throw InputException();
+    Emulator::Options options;
+    string inputFile;
 
-    Emulator emulator(argv[1]);
+    for(int i = 1; i < argc; i++){
+      string arg = argv[i];
+      if(arg[0] == '-'){
+        if(!checkOption(arg, options)) throw InputException();
+      } else {
+        if(inputFile != "") throw InputException();
+        inputFile = arg;
+      }
+    }
+
+    if(inputFile == "") throw InputException();
+    if(!checkInputData(inputFile)) throw InputException();
+
+    Emulator emulator(inputFile, options);
     int ret = emulator.emulate();
 
     if(ret == -1) throw NonexistantInputFileException();
+    if(ret == -2) throw InvalidImageException();
+    if(ret == -3) throw InvalidHexFileException();
+    if(ret == -4) throw NonexistantSymbolMapException();
 
     return 0;
   }
@@ -1532,4 +2652,4 @@ int main(int argc, char const *argv[]){
     std::cerr << e.what() << '\n';
   }
   
-}
\ No newline at end of file
+}
@@ -5,6 +5,22 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <queue>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <termios.h>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include "trace.hpp"
+#include "terminal.hpp"
+#include "../common/image.hpp"
 
 using namespace std;
 
@@ -12,70 +28,211 @@ class Emulator{
 
 public:
 
-  Emulator(string inputFileString);
+  enum DispatchMode{ SWITCH, TABLE, THREADED, BLOCK};
+
+  struct Options{
+    DispatchMode dispatch = SWITCH;
+    bool trace = false;                           // -trace[=file]
+    bool traceBinary = false;                     // -trace-binary, decoded with emutrace
+    string traceFile;                             // empty - helper.emulator.hex or helper.emulator.trace
+    unsigned int traceStart = 0;                  // -trace-range=start:end
+    unsigned int traceEnd = 65536;
+    unsigned long traceEvery = 1;                 // -trace-every=N
+    bool idleSkip = true;                         // -no-idle-skip executes idle loops instruction by instruction
+    bool profile = false;                         // -profile[=file]
+    string profileFile;                           // empty - helper.emulator.profile
+    string symbolFile;                            // -symbols=file, names for profile
+    bool terminal = false;                        // -terminal, stdin is read into term_in
+  };
+
+  Emulator(string inputFileString, Options options);
   int emulate();
   
 private:
 
   bool openFile();
-  void loadMemory();
-  vector<string> decToCode(string num);
+  bool loadMemory();
+  bool loadImage();
+  unsigned short readWord(unsigned int address);
+  void writeWord(unsigned int address, unsigned int value);
 
   ifstream inputFile;
   string inputFileName;
+  Options options;
+
+  static const size_t TRACE_BUFFER_SIZE = 1 << 20;
+  vector<char> traceBuffer;     // has to outlive traceStream
+  ofstream traceStream;
+  unsigned long traceCounter = 0;
+
+  static const size_t TRACE_RECORDS = 1 << 16;
+  vector<TraceRecord> traceRecords;   // binary records waiting to be written
+  unsigned int traceRegisters[9];     // registers as seen by last record
   bool stop = false;
-  vector<string> Memory;
+
+  static const unsigned int MEMORY_SIZE = 65536;
+  static const unsigned int ADDRESS_MASK = MEMORY_SIZE - 1;
+  uint8_t Memory[MEMORY_SIZE];    // flat little-endian address space
   unsigned int reg[9];   // r[0-7] + psw
 
-  enum Registers{ R0, R1, R2, R3, R4, R5, R6, SP = R6, R7, PC = R7, R8, PSW = R8, ERRORREG};
-  enum AddressType{ IMMED, REGDIR, REGIND, REGINDPOM, MEMDIR, REGDIRPOM, ERRORADDR};
-  enum AddressUpdate{ NOUPD, DECBEFORE, INCBEFORE, DECAFTER, INCAFTER, ERRORUPD};
-  enum OPCode{ HALT, INT, IRET, CALL, RET, JUMP, XCHG, ARITHMETIC, LOGIC, SHIFT, LOAD, STORE, ERROROP};
-  enum JumpInstr{ NOTJMP, JMP, JEQ, JNE, JGT, ERRORJMP};
-  enum ArithmeticInstr{ NOTARITHMETIC, ADD, SUB, MUL, DIV, CMP, ERRORARITHMETHIC};
-  enum LogicInstr{ NOTLOGIC, NOT, AND, OR, XOR, TEST, ERRORLOGIC};
-  enum ShiftInstr{ NOTSHIFT, SHL, SHR, ERRORSHIFT};
-  enum InterruptType{ NOTMASKED, MASKED};
+  // uint8_t based so that decoded Instruction stays compact
+  enum Registers : uint8_t{ R0, R1, R2, R3, R4, R5, R6, SP = R6, R7, PC = R7, R8, PSW = R8, ERRORREG};
+  enum AddressType : uint8_t{ IMMED, REGDIR, REGIND, REGINDPOM, MEMDIR, REGDIRPOM, ERRORADDR};
+  enum AddressUpdate : uint8_t{ NOUPD, DECBEFORE, INCBEFORE, DECAFTER, INCAFTER, ERRORUPD};
+  enum OPCode : uint8_t{ HALT, INT, IRET, CALL, RET, JUMP, XCHG, ARITHMETIC, LOGIC, SHIFT, LOAD, STORE, ERROROP};
+  enum JumpInstr : uint8_t{ NOTJMP, JMP, JEQ, JNE, JGT, ERRORJMP};
+  enum ArithmeticInstr : uint8_t{ NOTARITHMETIC, ADD, SUB, MUL, DIV, CMP, ERRORARITHMETHIC};
+  enum LogicInstr : uint8_t{ NOTLOGIC, NOT, AND, OR, XOR, TEST, ERRORLOGIC};
+  enum ShiftInstr : uint8_t{ NOTSHIFT, SHL, SHR, ERRORSHIFT};
+
+  // IVT entries and psw bits of interrupt controller
+  enum InterruptEntry{ RESET_ENTRY, ERROR_ENTRY, TIMER_ENTRY, TERMINAL_ENTRY};
+  static const unsigned int PSW_TR = 1 << 13;     // timer interrupt masked
+  static const unsigned int PSW_TL = 1 << 14;     // terminal interrupt masked
+  static const unsigned int PSW_I = 1 << 15;      // all maskable interrupts masked
+  static const uint8_t NONMASKABLE_INTERRUPTS = 1 << RESET_ENTRY | 1 << ERROR_ENTRY;
 
   struct Instruction{
-    AddressType addressType;
-    AddressUpdate addressUpdate;
-    OPCode operation;
+    AddressType addressType = IMMED;
+    AddressUpdate addressUpdate = NOUPD;
+    OPCode operation = ERROROP;
     JumpInstr jump = NOTJMP;
     ArithmeticInstr arithemtic = NOTARITHMETIC;
     LogicInstr logic = NOTLOGIC;
     ShiftInstr shift = NOTSHIFT;
-    int size = 0;
-    Registers regD;
-    Registers regS;
-    string dataLow, dataHigh;
+    uint8_t size = 0;
+    Registers regD = ERRORREG;
+    Registers regS = ERRORREG;
+    unsigned short data = 0;   // payload of 5B instructions
+    uint8_t opcode = 0;        // first instruction byte, index in dispatch table
+  };
+
+  Instruction instruction;
+  uint8_t pendingInterrupts = 0;    // bit i - interrupt for IVT entry i is waiting
+
+  // devices are driven by events on emulated cycle count, main loop only compares with the first deadline
+  static const unsigned long long CYCLES_PER_MS = 1000;   // one instruction is one cycle at 1 MHz
+  static const unsigned int MMIO_START = 0xFF00;          // memory mapped device registers
+  static const unsigned int TIM_CFG = 0xFF10;             // timer period, 0 - 500ms ... 7 - 60s
+  static const unsigned int TERM_OUT = 0xFF00;            // character written here is printed
+  static const unsigned int TERM_IN = 0xFF02;             // last character read, terminal interrupt follows
+  static const unsigned long long TERMINAL_POLL_CYCLES = 1000;   // characters already read come 1ms apart
+
+  enum Device{ TIMER_DEVICE, TERMINAL_DEVICE};
+
+  struct Event{
+    unsigned long long cycle;
+    Device device;
+    unsigned int generation;        // event is dropped if device was reconfigured after it was scheduled
+
+    bool operator>(const Event& other) const{
+      return cycle > other.cycle;
+    };
   };
 
-  struct Interrupt{
-    InterruptType interruptType;
-    int entry;
+  priority_queue<Event, vector<Event>, greater<Event>> events;
+  unsigned long long cycles = 0;
+  // cycle of first event, all ones if there are no events, 0 when reader thread wakes emulator
+  atomic<unsigned long long> nextEventCycle{~0ULL};
+  unsigned int timerGeneration = 0;
+
+  // profiler, instructions retired per pc and calls per call target
+  struct ProfileFrame{
+    unsigned int target;
+    unsigned long long startCycle;
   };
 
-  Instruction instruction;
-  vector<Interrupt> Interrupts;
-
-  OPCode getOPCode(char s);
-  JumpInstr getJumpType(char s);
-  Registers getRegister(char s);
-  AddressType getAddressType(char s);
-  AddressUpdate getAddressUpdate(char s);
-  ArithmeticInstr getArithmeticInstr(char s);
-  LogicInstr getLogicInstr(char s);
-  ShiftInstr getShiftInstr(char s);
-  JumpInstr getJumpInstr(char s);
+  struct ProfileTarget{
+    unsigned long long calls = 0;
+    unsigned long long inclusive = 0;       // cycles spent in calls, recursive calls are counted again
+  };
+
+  vector<unsigned long long> profileCounts;                     // MEMORY_SIZE counters indexed by pc
+  vector<ProfileFrame> profileStack;
+  unordered_map<unsigned int, ProfileTarget> profileTargets;    // call target -> calls
+  unordered_map<unsigned int, unsigned long long> profileEdges; // call site << 16 | call target -> calls
+  vector<pair<unsigned int, string>> symbolMap;                 // address -> name, sorted by address
+
+  bool loadSymbolMap();
+  int findSymbol(unsigned int address);
+  string symbolName(unsigned int address);
+  void profileCall(unsigned int site);
+  void profileReturn();
+  void writeProfile();
+
+  // idle loop detection, state on previous backward jump
+  unsigned int idleRegisters[9] = {};
+  unsigned long long idleCycle = 0;
+  unsigned long long idleWrites = ~0ULL;
+  unsigned long long memoryWrites = 0;        // writeWord calls and device events
+
+  void checkIdle();
+  void scheduleEvent(unsigned long long cycle, Device device, unsigned int generation);
+  void runEvents();
+  void updateNextEvent();
+  void writeRegister(unsigned int address);
+  unsigned long long timerPeriod();
+  void startTimer();
+
+  // terminal output is batched until new line or full buffer, input is read by reader thread
+  static const size_t TERMINAL_BUFFER_SIZE = 4096;
+  char terminalBuffer[TERMINAL_BUFFER_SIZE];
+  size_t terminalBufferSize = 0;
+  SPSCQueue<char, 1024> terminalInput;
+  thread terminalReader;
+  atomic<bool> terminalStop{false};
+  atomic<bool> terminalWake{false};       // reader pushed input that emulator hasn't polled yet
+  bool terminalPolling = false;           // poll event is scheduled, queue had more characters
+  int terminalWakePipe[2] = {-1, -1};     // written when emulator halts so that reader leaves poll
+  // settings before raw mode, static so that exit and signal handlers can restore them
+  static struct termios terminalSettings;
+  static volatile sig_atomic_t terminalRaw;
+  static void restoreTerminal();
+  static void terminalSignal(int sig);
+
+  void startTerminal();
+  void stopTerminal();
+  void readTerminal();
+  void wakeTerminal();
+  void pollTerminal(unsigned long long cycle);
+  void writeTerminal(char c);
+  void flushTerminal();
+
+  vector<Instruction> instructionCache;   // decoded instructions indexed by address
+  vector<bool> instructionCacheValid;
+
+  OPCode getOPCode(uint8_t s);
+  JumpInstr getJumpType(uint8_t s);
+  Registers getRegister(uint8_t s);
+  AddressType getAddressType(uint8_t s);
+  AddressUpdate getAddressUpdate(uint8_t s);
+  ArithmeticInstr getArithmeticInstr(uint8_t s);
+  LogicInstr getLogicInstr(uint8_t s);
+  ShiftInstr getShiftInstr(uint8_t s);
+  JumpInstr getJumpInstr(uint8_t s);
   int getRegIndex(Registers reg);  
-  void PCJumpChange();
-  void addInterrupt();
-  int checkUnmaskedInterrupts();
+  unsigned int getInstructionData();
+  bool PCJumpChange();
+  void addInterrupt(unsigned int entry = ERROR_ENTRY);
+  uint8_t unmaskedInterrupts();
 
+  void decodeInstruction(unsigned int address, Instruction& instruction);
   void getInstruction();
+  void traceInstruction();
+  void openTrace();
+  void closeTrace();
+  void traceRecord(unsigned int pc);
+  void flushTraceRecords();
+  void fetch();
+  void startInstruction(const Instruction& ins);
+  void invalidateInstructionCache(unsigned int address);
   void execute();
-  void executeInterrupt(Interrupt interrupt);
+  void emulateSwitch();
+  void emulateTable();
+  void emulateThreaded();
+  void executeInterrupt(unsigned int entry);
+  void acceptInterrupt();
+  bool interruptDue();
   void interrupt();
 
   void _halt();
@@ -102,6 +259,44 @@ private:
   void _shr();
   void _load();
   void _store();
+  void _error();
+
+  // handlers in the order of dispatch table ids
+  enum HandlerId{ ID_HALT, ID_INT, ID_IRET, ID_CALL, ID_RET, ID_JMP, ID_JEQ, ID_JNE, ID_JGT, ID_XCHG, ID_ADD, ID_SUB, ID_MUL, 
+    ID_DIV, ID_CMP, ID_NOT, ID_AND, ID_OR, ID_XOR, ID_TEST, ID_SHL, ID_SHR, ID_LOAD, ID_STORE, ID_ERROR, HANDLER_COUNT};
+
+  typedef void (Emulator::*Handler)();
+  Handler dispatchTable[256];   // first instruction byte -> handler
+
+  HandlerId getHandlerId(uint8_t opcode);
+  void setDispatchTable();
+
+  // basic block translation
+  static const unsigned int MAX_BLOCK_SIZE = 64;
+
+  struct TranslatedOp{
+    unsigned int pc;            // address of first instruction
+    function<void()> run;       // executes instructions with operands already resolved
+  };
+
+  struct Block{
+    unsigned int start;
+    unsigned int end;           // address after last instruction
+    vector<TranslatedOp> ops;
+  };
+
+  unordered_map<unsigned int, Block> blockCache;    // start address -> block
+  vector<bool> translatedCode;                      // bytes that belong to some translated block
+  bool blockCacheDirty = false;
+  bool exitBlock = false;
+
+  bool endsBlock(const Instruction& ins);
+  void translateInstruction(const Instruction& ins, TranslatedOp& op);
+  bool fuseInstructions(const Instruction& first, const Instruction& second, TranslatedOp& op);
+  void translateBlock(unsigned int address, Block& block);
+  Block& getBlock(unsigned int address);
+  void flushBlocks();
+  void emulateBlocks();
 
   string toStringOPCode();
   string toStringJumpType();
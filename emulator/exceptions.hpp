@@ -14,4 +14,28 @@ public:
   const char* what() const throw(){
     return "Input file doesn't exist";
   };
-};
\ No newline at end of file
+};
+
+class InvalidImageException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Input file isn't valid memory image";
+  };
+};
+
+class InvalidHexFileException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Input file isn't valid hex file";
+  };
+};
+
+class NonexistantSymbolMapException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Symbol map doesn't exist";
+  };
+};
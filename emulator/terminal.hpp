@@ -0,0 +1,42 @@
+#include <atomic>
+#include <cstddef>
+
+// Lock-free queue for one producer thread and one consumer thread, used for terminal input.
+// Capacity has to be power of two, head and tail only grow and are masked on access.
+template<typename T, size_t Capacity>
+class SPSCQueue{
+
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be power of two");
+
+public:
+
+  // called only by producer
+  bool push(const T& value){
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    if(tail - head.load(std::memory_order_acquire) == Capacity) return false;     // full
+
+    buffer[tail & (Capacity - 1)] = value;
+    this->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  };
+
+  // called only by consumer
+  bool pop(T& value){
+    size_t head = this->head.load(std::memory_order_relaxed);
+    if(head == tail.load(std::memory_order_acquire)) return false;                // empty
+
+    value = buffer[head & (Capacity - 1)];
+    this->head.store(head + 1, std::memory_order_release);
+    return true;
+  };
+
+  bool empty() const{
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  };
+
+private:
+
+  T buffer[Capacity];
+  std::atomic<size_t> head{0};      // next element that is popped
+  std::atomic<size_t> tail{0};      // next free slot
+};
@@ -0,0 +1,28 @@
+#include <cstdint>
+
+// Binary trace written by emulator with -trace-binary and read by emutrace.
+// File is one TraceHeader followed by fixed-size TraceRecords.
+
+const char TRACE_MAGIC[4] = {'E', 'M', 'T', 'R'};
+const uint16_t TRACE_VERSION = 1;
+const uint8_t TRACE_NO_REGISTER = 0xFF;
+
+struct TraceHeader{
+  char magic[4];
+  uint16_t version;
+  uint16_t recordSize;
+};
+
+// One executed instruction. Registers are written as deltas against the previous record,
+// PC is always equal to pc unless it is listed in changed. When more than two registers
+// changed, records with size 0 carrying only deltas come before the instruction record.
+struct TraceRecord{
+  uint16_t pc;
+  uint8_t code[5];        // raw instruction bytes, only size of them are valid
+  uint8_t size;           // 0 - record only carries register deltas
+  uint8_t changed[2];     // register indexes, TRACE_NO_REGISTER if slot is unused
+  uint16_t reserved;
+  uint32_t value[2];      // new register values
+};
+
+static_assert(sizeof(TraceRecord) == 20, "TraceRecord has to stay fixed-size");
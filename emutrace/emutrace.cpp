@@ -0,0 +1,230 @@
+#include "emutrace.hpp"
+#include "exceptions.hpp"
+
+/**
+ * @brief Construct a new EmuTrace:: EmuTrace object
+ * 
+ * @param inputFile binary trace written by emulator
+ * @param outputFile text trace, empty string - standard output
+ */
+EmuTrace::EmuTrace(string inputFile, string outputFile){
+  inputFileString = inputFile;
+  outputFileString = outputFile;
+  for(int i = 0; i < 9; i++){
+    reg[i] = 0;
+  }
+}
+
+/**
+ * @brief Opens input and output files
+ * 
+ * @return true input file exists
+ * @return false input file does not exist
+ */
+bool EmuTrace::openFiles(){
+  inputFile.open(inputFileString, ios::in|ios::binary);
+  if(!inputFile.is_open()) return false;
+
+  if(outputFileString != "") outputFile.open(outputFileString, ios::out|ios::trunc);
+  return true;
+}
+
+/**
+ * @brief Decodes raw instruction bytes the same way emulator does
+ * 
+ * @param record record with instruction bytes
+ * @return EmuTrace::Instruction 
+ */
+EmuTrace::Instruction EmuTrace::decodeInstruction(const TraceRecord& record){
+
+  Instruction instruction;
+  uint8_t high = record.code[0] >> 4;
+  instruction.operation = high <= 0xB ? (OPCode)high : ERROROP;
+
+  if(record.size >= 2){
+    uint8_t regD = record.code[1] >> 4, regS = record.code[1] & 0xF;
+    instruction.regD = regD <= 8 ? (Registers)regD : ERRORREG;
+    instruction.regS = regS <= 8 ? (Registers)regS : ERRORREG;
+  }
+
+  if(record.size >= 3){
+    uint8_t type = record.code[2] & 0xF, update = record.code[2] >> 4;
+    instruction.addressType = type <= 5 ? (AddressType)type : ERRORADDR;
+
+    if(instruction.addressType == REGIND || instruction.addressType == REGINDPOM){
+      instruction.addressUpdate = update <= 4 ? (AddressUpdate)update : ERRORUPD;
+    }
+  }
+
+  if(record.size == 5){
+    instruction.data = (record.code[3] << 8) | record.code[4];
+  }
+
+  return instruction;
+}
+
+/**
+ * @brief Return what instruction it is
+ * 
+ * @param operation 
+ * @return string 
+ */
+string EmuTrace::toStringOPCode(OPCode operation){
+  switch(operation){
+    case HALT: return "HALT";
+    case INT: return "INT";
+    case IRET: return "IRET";
+    case CALL: return "CALL";
+    case RET: return "RET";
+    case JUMP: return "JUMP";
+    case XCHG: return "XCHG";
+    case ARITHMETIC: return "ARITHMETIC";
+    case LOGIC: return "LOGIC";
+    case SHIFT: return "SHIFT";
+    case LOAD: return "LOAD";
+    case STORE: return "STORE";
+    default: return "ERROROP";
+  }
+}
+
+/**
+ * @brief Return what register it is in string
+ * 
+ * @param reg 
+ * @return string 
+ */
+string EmuTrace::toStringRegister(Registers reg){
+  switch(reg){
+    case R0: return "R0";
+    case R1: return "R1";
+    case R2: return "R2";
+    case R3: return "R3";
+    case R4: return "R4";
+    case R5: return "R5";
+    case R6: return "SP";
+    case R7: return "PC";
+    case R8: return "PSW";
+    default: return "ERRORREG";
+  }
+}
+
+/**
+ * @brief Return string value of address type
+ * 
+ * @param addressType 
+ * @return string 
+ */
+string EmuTrace::toStringAddressType(AddressType addressType){
+  switch(addressType){
+    case IMMED: return "IMMED";
+    case REGDIR: return "REGDIR";
+    case REGIND: return "REGIND";
+    case REGINDPOM: return "REGINDPOM";
+    case MEMDIR: return "MEMDIR";
+    case REGDIRPOM: return "REGDIRPOM";
+    default: return "ERRORADDR";
+  }
+}
+
+/**
+ * @brief Return string value of address update
+ * 
+ * @param addressUpdate 
+ * @return string 
+ */
+string EmuTrace::toStringAddressUpdate(AddressUpdate addressUpdate){
+  switch(addressUpdate){
+    case NOUPD: return "NOUPD";
+    case DECBEFORE: return "DECBEFORE";
+    case INCBEFORE: return "INCBEFORE";
+    case DECAFTER: return "DECAFTER";
+    case INCAFTER: return "INCAFTER";
+    default: return "ERRORUPD";
+  }
+}
+
+/**
+ * @brief Applies register deltas and prints instruction in the same form as emulator -trace
+ * 
+ * @param record binary record
+ * @param out where text is written
+ */
+void EmuTrace::printRecord(const TraceRecord& record, ostream& out){
+
+  reg[7] = record.pc;
+  for(int i = 0; i < 2; i++){
+    if(record.changed[i] < 9) reg[record.changed[i]] = record.value[i];
+  }
+
+  if(record.size == 0) return;   // only deltas
+
+  Instruction instruction = decodeInstruction(record);
+  out << toStringOPCode(instruction.operation) << "\t" << toStringAddressType(instruction.addressType) << "\t" 
+  << toStringAddressUpdate(instruction.addressUpdate) << " RegD " << toStringRegister(instruction.regD) 
+  << "\tRegS " << toStringRegister(instruction.regS)  << "\t" << hex << uppercase << setfill('0') << setw(4) << instruction.data << dec << '\n';
+
+  for(int i = 0; i < 9; i++){
+    out << "R[" << i << "]:\t" << reg[i] << "\t\t";
+    if(i % 3 == 2) out << '\n';
+  }
+  out << "\n\n";
+}
+
+/**
+ * @brief Decodes whole binary trace
+ * 
+ * @return int 0 - everything is good, -1 input file doesn't exist, -2 input file is not binary trace
+ */
+int EmuTrace::decode(){
+
+  if(!openFiles()) return -1;
+
+  TraceHeader header;
+  inputFile.read((char*)&header, sizeof(header));
+  if(!inputFile || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION 
+  || header.recordSize != sizeof(TraceRecord)){
+    return -2;
+  }
+
+  ostream& out = outputFileString != "" ? outputFile : cout;
+  vector<TraceRecord> records(RECORDS);
+
+  while(inputFile){
+    inputFile.read((char*)records.data(), records.size() * sizeof(TraceRecord));
+    size_t count = inputFile.gcount() / sizeof(TraceRecord);
+
+    for(size_t i = 0; i < count; i++){
+      printRecord(records[i], out);
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char const *argv[]){
+  try{
+    string inputFile, outputFile;
+
+    // emutrace [-o output] input.trace
+    int i = 1;
+    if(argc > 1 && string(argv[1]) == "-o"){
+      if(argc < 3) throw InputException();
+      outputFile = argv[2];
+      i = 3;
+    }
+    if(argc != i + 1) throw InputException();
+    inputFile = argv[i];
+
+    EmuTrace emuTrace(inputFile, outputFile);
+    int ret = emuTrace.decode();
+
+    if(ret == -1) throw NonexistantInputFileException();
+    if(ret == -2) throw BadTraceFileException();
+
+    return 0;
+  }
+  catch(const std::exception& e){
+    std::cerr << e.what() << '\n';
+  }
+
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <cstdint>
+#include "../emulator/trace.hpp"
+
+using namespace std;
+
+class EmuTrace{
+
+public:
+
+  EmuTrace(string inputFileString, string outputFileString);
+  int decode();
+
+private:
+
+  bool openFiles();
+  void printRecord(const TraceRecord& record, ostream& out);
+
+  string inputFileString, outputFileString;
+  ifstream inputFile;
+  ofstream outputFile;
+  unsigned int reg[9];    // r[0-7] + psw, rebuilt from deltas
+
+  static const size_t RECORDS = 1 << 16;
+
+  // same decoding as in emulator, only what text trace prints
+  enum Registers{ R0, R1, R2, R3, R4, R5, R6, SP = R6, R7, PC = R7, R8, PSW = R8, ERRORREG};
+  enum AddressType{ IMMED, REGDIR, REGIND, REGINDPOM, MEMDIR, REGDIRPOM, ERRORADDR};
+  enum AddressUpdate{ NOUPD, DECBEFORE, INCBEFORE, DECAFTER, INCAFTER, ERRORUPD};
+  enum OPCode{ HALT, INT, IRET, CALL, RET, JUMP, XCHG, ARITHMETIC, LOGIC, SHIFT, LOAD, STORE, ERROROP};
+
+  struct Instruction{
+    AddressType addressType = IMMED;
+    AddressUpdate addressUpdate = NOUPD;
+    OPCode operation = ERROROP;
+    Registers regD = ERRORREG;
+    Registers regS = ERRORREG;
+    unsigned short data = 0;
+  };
+
+  Instruction decodeInstruction(const TraceRecord& record);
+
+  string toStringOPCode(OPCode operation);
+  string toStringRegister(Registers reg);
+  string toStringAddressType(AddressType addressType);
+  string toStringAddressUpdate(AddressUpdate addressUpdate);
+
+};
@@ -0,0 +1,25 @@
+#include <exception>
+
+class InputException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Wrong terminal input";
+  };
+};
+
+class NonexistantInputFileException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Input file doesn't exist";
+  };
+};
+
+class BadTraceFileException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Input file is not emulator binary trace";
+  };
+};
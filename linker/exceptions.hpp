@@ -30,4 +30,28 @@ public:
   const char* what() const throw(){
     return "Undefined symbol found!";
   };
-};
\ No newline at end of file
+};
+
+class InvalidObjectFileException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Input file isn't valid object file!";
+  };
+};
+
+class ImageException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Memory image or symbol map couldn't be written!";
+  };
+};
+
+class SectionPlacementException: public std::exception{
+
+public:
+  const char* what() const throw(){
+    return "Sections overlap or don't fit in memory!";
+  };
+};
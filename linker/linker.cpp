@@ -4,9 +4,9 @@
 /**
  * @brief checks input data
  * 
- * @param option1 option has tu be "-hex"
+ * @param option1 option has tu be "-hex" or "-binary"
  * @param option2 option has to be "-o"
- * @param outputFile after option2, output File has to be .hex
+ * @param outputFile after option2, output File has to be .hex for -hex and .bin for -binary
  * @param inputFiles after output File, input files have to be .o
  * @return true everything is good
  * @return false something is bad
@@ -15,10 +15,10 @@ bool checkInputData(string option1, string option2, string outputFile, vector<st
 
   if(inputFiles.size() == 0) return false;
 
-  if(option1 != "-hex" || option2 != "-o" || outputFile.substr(outputFile.find_last_of(".")+1) != "hex")
+  string extension = outputFile.substr(outputFile.find_last_of(".")+1);
+  if(option2 != "-o" || !((option1 == "-hex" && extension == "hex") || (option1 == "-binary" && extension == "bin")))
     return false;
 
-  int i = 0;
   for(string s: inputFiles){
     if(s.substr(s.find_last_of(".")+1) != "o")
       return false;
@@ -27,13 +27,51 @@ bool checkInputData(string option1, string option2, string outputFile, vector<st
   return true;
 }
 
+/**
+ * @brief checks option that isn't -hex or -o
+ *
+ * @param option option from terminal
+ * @param options options that are set
+ * @return true option is good
+ * @return false option is unknown or has bad value
+ */
+bool checkOption(string option, Linker::Options& options){
+
+  try{
+    if(option.compare(0, 9, "-threads=") == 0){     // -threads=<N>, number of threads for parsing and relocations
+      size_t pos;
+      int threads = stoi(option.substr(9), &pos);
+      options.threads = threads;
+      return pos == option.size() - 9 && threads > 0;
+    }
+    if(option.compare(0, 7, "-place=") == 0){       // -place=<section>@<address>, address can be hex with 0x
+      size_t at = option.find_last_of('@');
+      if(at == string::npos || at == 7 || at == option.size() - 1) return false;
+      size_t pos;
+      unsigned long address = stoul(option.substr(at + 1), &pos, 0);
+      if(pos != option.size() - at - 1 || address >= IMAGE_MEMORY_SIZE) return false;
+      return options.places.emplace(option.substr(7, at - 7), address).second;   // section can be placed once
+    }
+    if(option.compare(0, 5, "-map=") == 0){         // -map=<file>, symbol map for emulator profiler
+      options.mapFile = option.substr(5);
+      return options.mapFile != "";
+    }
+  }
+  catch(const std::exception& e){   // bad number
+    return false;
+  }
+
+  return false;
+}
+
 /**
  * @brief Construct a new Linker:: Linker object
  * 
  * @param inputFileStrings sets all input File names
  * @param outputFileString sets output file name
+ * @param options options from terminal
  */
-Linker::Linker(vector<string> inputFileStrings, string outputFileString){
+Linker::Linker(vector<string> inputFileStrings, string outputFileString, Options options){
 
   int i = 0;
   for(string s: inputFileStrings){
@@ -43,86 +81,63 @@ Linker::Linker(vector<string> inputFileStrings, string outputFileString){
 
   this->inputFileStrings = inputFileStrings;
   this->outputFileString = outputFileString;
+  this->options = options;
+  if(this->options.threads == 0) this->options.threads = max(1u, thread::hardware_concurrency());
 }
 
 /**
- * @brief turns dec number to machine code
+ * @brief writes byte as two uppercase hex digits, stream flags are not changed
  * 
- * @param num the number that need to be changed
- * @return vector<string> helper machine code
+ * @param out stream
+ * @param byte byte that is written
  */
-vector<string> Linker::decToCode(string num){
-  vector<string> ret;
-  
-  int n = stoi(num);
-  char help[8];
-  sprintf(help, "%X", n);
-  string help1 = (string)help;
-
-  if(help1.size() == 4){
-    ret.push_back(help1.substr(0,2));
-    ret.push_back(help1.substr(2,2));
-  } else {
-    if(help1.size() == 3){
-      ret.push_back("0" + help1.substr(0,1));
-      ret.push_back(help1.substr(1,2));
-    } else {
-      if(help1.size() == 2){
-        ret.push_back("00");
-        ret.push_back(help1.substr(0,2));
-      } else {
-        if(help1.size() == 1){
-          ret.push_back("00");
-          ret.push_back("0" + help1);
-        } else {  // here it means it is negative number
-          ret.push_back(help1.substr(4,2));
-          ret.push_back(help1.substr(6,2));
-        }        
-      }
-    }
-  }
-
-  return ret;
+static void writeHexByte(ostream& out, uint8_t byte){
+  static const char digits[] = "0123456789ABCDEF";
+  out << digits[byte >> 4] << digits[byte & 0xF];
 }
 
 /**
  * @brief searches if there section already exists
  * 
- * @param sec section that we search for
+ * @param name name of section that we search for
  * @return int -1 section doen't exist, other num section already exists
  */
-int Linker::searchSection(Section sec){
-  if(Sections.size() == 0) return -1;
-
-  int ret = 0;
-  for(Section s:Sections){
-    if(s.name == sec.name){
-      return ret;
-    }
-    ret++;
-  }
-
-  return -1;
+int Linker::searchSection(string_view name){
+  auto it = sectionIndex.find(name);
+  if(it == sectionIndex.end()) return -1;
+  return it->second;
 }
 
 /**
  * @brief searches if there symbol already exists
  * 
- * @param symb symbol that we search for
+ * @param name name of symbol that we search for
  * @return int -1 symbol doen't exist, other num symbol already exists
  */
-int Linker::searchSymbol(Symbol symb){
-  if(Symbols.size() == 0) return -1;
+int Linker::searchSymbol(string_view name){
+  auto it = symbolIndex.find(name);
+  if(it == symbolIndex.end()) return -1;
+  return it->second;
+}
 
-  int ret = 0;
-  for(Symbol s:Symbols){
-    if(s.symbolName == symb.symbolName){
-      return ret;
-    }
-    ret++;
-  }
+/**
+ * @brief adds section to section table
+ *
+ * @param sec section that is added, its name mustn't be in table already
+ */
+void Linker::addSection(const Section& sec){
+  sectionIndex[sec.name] = Sections.size();
+  Sections.push_back(sec);
+}
 
-  return -1;
+/**
+ * @brief adds symbol to global symbol table
+ *
+ * @param symb symbol that is added, its name mustn't be in table already
+ */
+void Linker::addSymbol(const Symbol& symb){
+  symbolIndex[symb.symbolName] = Symbols.size();
+  Symbols.push_back(symb);
 }
 
 /**
@@ -133,7 +148,7 @@ int Linker::searchSymbol(Symbol symb){
  */
 bool Linker::checkForUNDSymbols(){
 
-  for(Symbol s: Symbols){
+  for(const Symbol& s: Symbols){
     if(!s.defined && s.type != SCTN)
       return true;
   }
@@ -143,22 +158,71 @@ bool Linker::checkForUNDSymbols(){
 }
 
 /**
- * @brief sets machine code in right order
+ * @brief lays out sections and contributions of one section in order of files, sections from -place are put
+ * at their addresses and other sections follow the highest placed section in order of first appearance,
+ * sets base address of every section and contribution, copies code from mapped objects to output image
+ * and finds populated segments of image
  * 
+ * @return true everything is good
+ * @return false sections overlap or don't fit in memory
  */
-void Linker::setGoodCode(){
+bool Linker::setGoodCode(){
 
-  int start = 0;
-  for(Section s: Sections){
-    for(MachineCode mc: allMachineCode){
-      if(mc.sectionName == s.name){
+  vector<vector<int>> contributions(Sections.size());     // contributions of each section, in order of files
+  for(size_t k = 0; k < allMachineCode.size(); k++){
+    contributions[allMachineCode[k].sectionId].push_back(k);
+  }
 
-        start += mc.code.size();
-        goodMachineCode.push_back(mc);
+  vector<bool> placed(Sections.size(), false);
+  long base = 0;
+  for(size_t i = 0; i < Sections.size(); i++){
+    auto it = options.places.find(string(Sections[i].name));
+    if(it == options.places.end()) continue;            // places of sections that aren't linked are ignored
 
-      }
+    placed[i] = true;
+    Sections[i].base = it->second;
+    base = max(base, (long)Sections[i].base + Sections[i].size);
+  }
+
+  for(size_t i = 0; i < Sections.size(); i++){
+    if(placed[i]) continue;
+    Sections[i].base = base;
+    base += Sections[i].size;
+  }
+  if(base > IMAGE_MEMORY_SIZE) return false;
+
+  for(size_t i = 0; i < Sections.size(); i++){
+    int contributionBase = Sections[i].base;
+    for(int k: contributions[i]){
+      allMachineCode[k].base = contributionBase;
+      contributionBase += allMachineCode[k].size;
+    }
+  }
+
+  vector<int> order;                                    // sections that have code, by address
+  for(size_t i = 0; i < Sections.size(); i++){
+    if(Sections[i].size > 0) order.push_back(i);
+  }
+  sort(order.begin(), order.end(), [this](int a, int b){ return Sections[a].base < Sections[b].base; });
+
+  segments.clear();
+  for(int i: order){
+    const Section& sec = Sections[i];
+    if(!segments.empty() && segments.back().start + segments.back().size > (uint32_t)sec.base) return false;
+
+    if(!segments.empty() && segments.back().start + segments.back().size == (uint32_t)sec.base){
+      segments.back().size += sec.size;
+    } else {
+      segments.push_back({(uint32_t)sec.base, (uint32_t)sec.size});
     }
   }
+
+  image.assign(base, 0);
+  for(const MachineCode& mc: allMachineCode){
+    memcpy(image.data() + mc.base, mc.code, mc.size);
+  }
+
+  return true;
 }
 
 /**
@@ -167,88 +231,74 @@ void Linker::setGoodCode(){
  */
 void Linker::setSymbolOffset(){
 
-  int i = 1;
-  for(Symbol symb: Symbols){
-    if(symb.symbolName == "UND") continue;
-
-    int size = 0;
-    for(MachineCode mc: goodMachineCode){
-      if(mc.fileName == symb.fileName && mc.sectionName == Symbols[symb.sectionId].symbolName){
-        Symbols[i].offset += size;
-        size = 0;
-        break;
-      } else {
-        size += mc.code.size();
-      }
+  for(Symbol& symb: Symbols){
+    if(symb.contribution != -1){
+      symb.offset += allMachineCode[symb.contribution].base;
     }
-    i++;
   }
 
-  int sz = 0;
-  for(Section sec: Sections){
+  for(const Section& sec: Sections){
     if(sec.name == "UND") continue;
 
-    int j  = 0;
-    for(Symbol symb:Symbols){
-      if(symb.symbolName == sec.name){
-        Symbols[j].offset = sz;
-      }
-      j++;
+    int i = searchSymbol(sec.name);
+    if(i != -1){
+      Symbols[i].offset = sec.base;
     }
+  }
 
-    sz += sec.size;
-  }  
+}
 
+/**
+ * @brief writes 16-bit value to output image
+ *
+ * @param at first byte that is written
+ * @param value value, only lower 16 bits are used
+ * @param littleEndian lower byte first (.word) or higher byte first (instructions)
+ */
+static inline void write16(uint8_t* at, int value, bool littleEndian){
+  if(littleEndian){
+    at[0] = value & 0xFF;
+    at[1] = (value >> 8) & 0xFF;
+  } else {
+    at[0] = (value >> 8) & 0xFF;
+    at[1] = value & 0xFF;
+  }
 }
 
 /**
- * @brief changes Machine code at set locations
+ * @brief applies relocations of one (file, section) code, they only write inside of that code
  * 
+ * @param relos relocations of one (file, section) code
  */
-void Linker::doRelocations(){
+void Linker::applyRelocations(const Relocations& relos){
 
-  for(Relocations relos: allRelocations){
-
-    int i = 0, size = 0;
-    for(MachineCode mc: goodMachineCode){
-      if(mc.fileName == relos.fileName && mc.sectionName == relos.name){
-
-        int sz = relos.relocations.size();
-        for(int j = 0; j < sz; j++){
-          
-          if(relos.relocations[j].type == R_16){
-            string symbolValue = to_string(Symbols[relos.relocations[j].symbolId].offset + relos.relocations[j].addend);
-            vector<string> helper = decToCode(symbolValue);
-            goodMachineCode[i].code[relos.relocations[j].offset] = helper[0];
-            goodMachineCode[i].code[relos.relocations[j].offset + 1] = helper[1];
-          } else {
-
-            if(relos.relocations[j].type == R_WORD16){
-              string symbolValue = to_string(Symbols[relos.relocations[j].symbolId].offset);
-              vector<string> helper = decToCode(symbolValue);
-              goodMachineCode[i].code[relos.relocations[j].offset + relos.relocations[j].addend] = helper[1];
-              goodMachineCode[i].code[relos.relocations[j].offset + relos.relocations[j].addend + 1] = helper[0];
-            } else {
-              
-              int offsetSymb0 = size + relos.relocations[j].offset + 2;
-              int offsetSymb1 = Symbols[relos.relocations[j].symbolId].offset;
-              string help = to_string(offsetSymb1 - offsetSymb0);
-              vector<string> helper = decToCode(help);
-              goodMachineCode[i].code[relos.relocations[j].offset] = helper[0];
-              goodMachineCode[i].code[relos.relocations[j].offset + 1] = helper[1];
-            }
-                 
-          }
-
-        }
+  int base = allMachineCode[relos.contribution].base;
+  uint8_t* code = image.data() + base;
+  for(const Relocation& rel: relos.relocations){
 
+    int symbolValue = Symbols[rel.symbolId].offset;
+    switch(rel.type){
+      case R_16:
+        write16(code + rel.offset, symbolValue + rel.addend, false);
+        break;
+
+      case R_WORD16:
+        write16(code + rel.offset, symbolValue + rel.addend, true);
+        break;
+
+      case R_PC16:
+        write16(code + rel.offset, symbolValue - (base + rel.offset + 2), false);
         break;
-      }
-      i++;
-      size += mc.code.size();
     }
   }
+}
 
+/**
+ * @brief changes Machine code at set locations, relocations of different (file, section) codes are applied in parallel
+ * 
+ */
+void Linker::doRelocations(){
+  parallelFor(allRelocations.size(), options.threads, [this](size_t i){ applyRelocations(allRelocations[i]); });
 }
 
 /**
@@ -260,11 +310,11 @@ void Linker::printHelpFile(){
   ofstream linkerHelper;
   linkerHelper.open("linkerHelper.hex", ios::out|ios::trunc);
 
-  for(Section s: Sections){
+  for(const Section& s: Sections){
     linkerHelper << s.id << "\t" << s.size << "\t" << s.name << "\n";
   }
   linkerHelper << endl << endl;
-  for(Symbol s: Symbols){
+  for(const Symbol& s: Symbols){
     linkerHelper << s.id << "\t" << hex << s.offset << dec << "\t" << s.sectionId << "\t" << s.symbolName << "\t" << s.defined << "\t";
 
     switch(s.bind){
@@ -285,11 +335,11 @@ void Linker::printHelpFile(){
   }
   linkerHelper << endl << endl;
 
-  for(Relocations rels: allRelocations){
+  for(const Relocations& rels: allRelocations){
 
     linkerHelper << "Relocations from section " << rels.name << "\t FILE NAME: " << rels.fileName << endl;
 
-    for(Relocation rel: rels.relocations){
+    for(const Relocation& rel: rels.relocations){
       linkerHelper << hex << rel.offset << dec << "\t";
       switch(rel.type){
         case R_16:
@@ -308,335 +358,326 @@ void Linker::printHelpFile(){
     linkerHelper << endl;
   }
 
-  for(MachineCode mc:allMachineCode){
+  for(const MachineCode& mc: allMachineCode){
     linkerHelper << "Machine code from section " << mc.sectionName << "\t FILE NAME: " << mc.fileName << endl;
 
-    int i = 0;
-    for(string s: mc.code){
+    for(size_t i = 0; i < mc.size; i++){
       if(i % 8 == 0){
         linkerHelper << endl << hex << setfill('0') << setw(4) << i << dec << ": ";
       }
-      linkerHelper << s << " ";
-      i++;
+      writeHexByte(linkerHelper, mc.code[i]);
+      linkerHelper << " ";
     }
     linkerHelper << endl;
   }
 
   linkerHelper << endl << endl << "All machine code linked (GOOD CODE)\n";
 
-  this->outputFile.open(outputFileString, ios::out|ios::trunc);
-
-  int j = 0;
-  for(MachineCode mc: goodMachineCode){
-    for(string s: mc.code){
+  for(const ImageRange& seg: segments){
+    for(uint32_t j = seg.start; j < seg.start + seg.size; j++){
 
-      if(j % 8 == 0){
+      if((j - seg.start) % 8 == 0){
         linkerHelper << endl << hex << setfill('0') << setw(4) << j << dec << ": ";
       }
-      linkerHelper << s << " ";
-      j++;
+      writeHexByte(linkerHelper, image[j]);
+      linkerHelper << " ";
     }
-
   }
 
-  j = 0;
-  for(MachineCode mc: goodMachineCode){
-    for(string s: mc.code){
+  linkerHelper.close();
 
-      if(j == 0){
-        this->outputFile << hex << setfill('0') << setw(4) << j << dec << ": ";
-      } else {
-        if(j % 8 == 0){
-          this->outputFile << endl << hex << setfill('0') << setw(4) << j << dec << ": ";
-        } 
+}
+
+/**
+ * @brief prints linked code as hex file for emulator, only populated segments are printed
+ * and every segment starts with its address and length
+ * 
+ */
+void Linker::printHex(){
+
+  this->outputFile.open(outputFileString, ios::out|ios::trunc);
+
+  bool first = true;
+  for(const ImageRange& seg: segments){
+    if(!first) this->outputFile << endl;
+    this->outputFile << "@" << hex << setfill('0') << setw(4) << seg.start << " " << setw(4) << seg.size << dec;
+    first = false;
+
+    for(uint32_t j = seg.start; j < seg.start + seg.size; j++){
+
+      if((j - seg.start) % 8 == 0){
+        this->outputFile << endl << hex << setfill('0') << setw(4) << j << dec << ": ";
       }
-      
-      if(j % 8 == 7){
-        this->outputFile<< s;
-      } else{
-        this->outputFile<< s << " ";
+
+      writeHexByte(this->outputFile, image[j]);
+      if((j - seg.start) % 8 != 7 && j != seg.start + seg.size - 1){
+        this->outputFile << " ";
       }
-      j++;
     }
-
   }
 
-  linkerHelper.close();
-
 }
 
 /**
- * @brief Linker links all input files
+ * @brief writes linked code as raw memory image for emulator, entry is word at address 0 (reset routine)
  * 
- * @return int 0 - everything is okay, -1 - wrong terminal input, -2 - some input files don't exist
+ * @return true image is written
+ * @return false file couldn't be written
+ */
+bool Linker::writeImage(){
+
+  ImageHeader header;
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.version = IMAGE_VERSION;
+  header.entry = image.size() >= 2 ? image[0] | (image[1] << 8) : 0;
+  header.rangeCount = segments.size();
+
+  vector<uint8_t> memory(IMAGE_MEMORY_SIZE, 0);
+  memcpy(memory.data(), image.data(), image.size());
+
+  this->outputFile.open(outputFileString, ios::out|ios::trunc|ios::binary);
+  this->outputFile.write((const char*)&header, sizeof(header));
+  this->outputFile.write((const char*)segments.data(), segments.size() * sizeof(ImageRange));
+  this->outputFile.write((const char*)memory.data(), memory.size());
+
+  return this->outputFile.good();
+}
+
+/**
+ * @brief writes address and name of every defined symbol and section sorted by address, section comes before
+ * symbols at same address so that address is named after symbol
  * 
+ * @return true map is written
+ * @return false file couldn't be written
  */
-int Linker::link(){
+bool Linker::writeMap(){
 
-  Symbol oldSection;
-  vector<Symbol> currentSymbols;
-  int currentRelocations;
-  int currentMC;
-  bool turn = true;
+  vector<const Symbol*> defined;
+  for(const Symbol& s: Symbols){
+    if(s.symbolName == "UND") continue;         // undefined symbols are already rejected
+    defined.push_back(&s);
+  }
+  stable_sort(defined.begin(), defined.end(), [](const Symbol* a, const Symbol* b){
+    if(a->offset != b->offset) return a->offset < b->offset;
+    return a->type == SCTN && b->type != SCTN;
+  });
+
+  ofstream map(options.mapFile, ios::out|ios::trunc);
+  for(const Symbol* s: defined){
+    map << hex << setfill('0') << setw(4) << s->offset << dec << " " << s->symbolName << "\n";
+  }
 
-  for(string s: this->inputFileStrings){
-    inputFile.open(s, ios::in);
+  return map.good();
+}
 
-    if(!inputFile.is_open()) return -2;
+/**
+ * @brief maps one input object and turns it into sections, symbols, relocations and code of that file,
+ * it only touches inputs[index] so it can run in parallel with other files
+ *
+ * @param index index of input file
+ */
+void Linker::parseObject(size_t index){
 
-    string line;
-    int current = -1;
+  ObjectInput& input = inputs[index];
+  const string& s = inputFileStrings[index];
 
-    while(getline(inputFile, line)){
+  ifstream file(s, ios::in);
+  if(!file.is_open()){
+    input.error = -2;
+    return;
+  }
+  file.close();
 
-      if(line == "" || line == "UND") continue;
+  const ObjectView& object = input.object;
+  if(!input.object.open(s)){
+    input.error = -5;
+    return;
+  }
 
-      if(line == "SECTIONS"){
-        current = 0;
-        continue;
-      }
+  unordered_map<string_view, int> contributions;    // section name -> index in input.code
+  for(uint32_t k = 0; k < object.header->sectionCount; k++){
+    const ObjectSection& osec = object.sections[k];
+    Section sec;
+    sec.size = osec.size;
+    sec.name = object.name(osec.name);
+    input.sections.push_back(sec);
+
+    if(k == 0) continue;    // section 0 is UND and has no code
+
+    MachineCode mc;
+    mc.sectionName = sec.name;
+    mc.fileName = s;
+    mc.code = object.code + osec.codeOffset;
+    mc.size = osec.size;
+    contributions[sec.name] = input.code.size();
+    input.code.push_back(mc);
+  }
 
-      if(line == "SYMBOLS"){
-        currentSymbols.clear();
-        current = 1;
-        continue;
+  for(uint32_t k = 0; k < object.header->symbolCount; k++){
+    const ObjectSymbol& osym = object.symbols[k];
+
+    Symbol symb;
+    symb.id = osym.id;
+    symb.offset = osym.offset;
+    symb.type = (SymbolType)osym.type;
+    symb.bind = (SymbolBind)osym.bind;
+    symb.sectionId = osym.sectionId;
+    symb.symbolName = object.name(osym.name);
+    symb.defined = osym.defined;
+    symb.contribution = -1;
+    if(symb.defined){
+      symb.fileName = s;
+      if(symb.type != SCTN && symb.sectionId != OBJECT_UND_SECTION){
+        auto it = contributions.find(object.name(object.symbols[symb.sectionId].name));
+        if(it != contributions.end()) symb.contribution = it->second;
       }
+    }
+    input.symbols.push_back(symb);
+  }
 
-      if(line == "RELOCATIONS"){
-        current = 2;
-        continue;
-      }
+  for(uint32_t k = 0; k < object.header->sectionCount; k++){
+    const ObjectSection& osec = object.sections[k];
+    if(osec.relocationCount == 0) continue;
+
+    Relocations relos;
+    relos.name = object.name(osec.name);
+    relos.fileName = s;
+    auto it = contributions.find(relos.name);
+    if(k == 0 || it == contributions.end()){    // relocations outside of code sections
+      input.error = -5;
+      return;
+    }
+    relos.contribution = it->second;
 
-      if(line == "MACHINE CODE"){
-        current = 3;
-        continue;
-      }
+    for(uint32_t j = osec.relocationStart; j < osec.relocationStart + osec.relocationCount; j++){
+      const ObjectRelocation& orel = object.relocations[j];
+      Relocation relo;
 
-      if(line == "END"){
-        break;
-      }
+      relo.offset = orel.offset;
+      relo.type = (RelocationType)orel.type;
+      relo.symbolId = orel.symbolId;
+      relo.addend = orel.addend;
 
-      if(current == -1) return -2;
-      
-      if(current == 0){
-        size_t pos = 0;
-        string delimiter = "\t";
-        
-        Section sec;
-        
-        int i = 0;
-        while((pos = line.find(delimiter)) != std::string::npos){
-          string token = line.substr(0, pos);
-          line.erase(0, pos + delimiter.length());
-
-          switch(i){
-            case 0:
-              sec.id = stoi(token);
-              break;
-            case 1:
-              sec.size = stoi(token);
-              break;
-          }
-          i++;
-        }
-        sec.name = line;
-        i = searchSection(sec);
-
-        if(i == -1){  // new section, add to sections
-          sec.id = Sections.size();
-          Sections.push_back(sec);
-        } else {      // section already exists, add to size only
-          Sections[i].size += sec.size;
-        }
+      relos.relocations.push_back(relo);
+    }
+    input.relocations.push_back(std::move(relos));
+  }
+}
 
-      }
+/**
+ * @brief merges parsed input file into global tables, files have to be merged in order of command line
+ *
+ * @param index index of input file
+ * @return int 0 - everything is okay, -3 - multiple definition of symbol
+ */
+int Linker::mergeObject(size_t index){
 
-      if(current == 1){
-        
-        size_t pos = 0;
-        string delimiter = "\t";
-        
-        Symbol symb;
-        int i = 0;
-        while((pos = line.find(delimiter)) != std::string::npos){
-          string token = line.substr(0, pos);
-          line.erase(0, pos + delimiter.length());
-
-          switch(i){
-            case 0:
-              symb.id = stoi(token);
-              break;
-
-            case 1:
-              sscanf(token.c_str(), "%X", &symb.offset);
-              break;
-
-            case 2:
-              if(token == "SCTN") symb.type = SCTN;
-              else if(token == "NOTYP") symb.type = NOTYP;
-              break;
-
-            case 3:
-              if(token == "NOBIND") symb.bind = NOBIND;
-              else if(token == "GLOB") symb.bind = GLOBAL;
-              else if(token == "LOC") symb.bind = LOCAL;
-              break;
-
-            case 4:
-              if(token == "UND") symb.sectionId = -1;
-              else symb.sectionId = stoi(token);
-              break;
-            
-            case 5:
-              symb.symbolName = token;
-              break;
-          }
-
-          i++;
-        }
-
-        if(line == "UND") symb.defined = false;
-        else if(line == "DEF") {
-          symb.defined = true;
-          symb.fileName = s;
-        }
-        i = searchSymbol(symb);
-
-        if(i == -1){
-          int oldId = symb.id;
-          symb.id = Symbols.size();
-          if(symb.type == SCTN){ 
-            oldSection = symb;
-            oldSection.id = symb.id;
-            symb.sectionId = symb.id;
-          }
-          Symbols.push_back(symb);
-
-          if(symb.type == SCTN && symb.symbolName != "UND"){    
-            int i = 0;        
-            for(Symbol s: Symbols){
-              if(s.sectionId == oldId && s.type != SCTN){
-                Symbols[i].sectionId= symb.id;
-              }
-              i++;
-            }
-          }
-
-        } else {
-          if(Symbols[i].defined && symb.defined){
-            return -3;
-          }
-          if(!Symbols[i].defined && symb.defined){
-            Symbols[i].defined = true;
-            Symbols[i].offset = symb.offset;
-            Symbols[i].sectionId = symb.sectionId;
-            Symbols[i].fileName = s;
-            if(Symbols[i].sectionId != oldSection.id){
-              for(Symbol ss: Symbols){
-                if(ss.symbolName == oldSection.symbolName){
-                  Symbols[i].sectionId = ss.id;
-                }
-              }
-            }
-              
-          }
-        }
-        currentSymbols.push_back(symb);
+  ObjectInput& input = inputs[index];
+  int codeBase = allMachineCode.size();
 
-      }
+  for(size_t k = 0; k < input.sections.size(); k++){
+    Section sec = input.sections[k];
+    int i = searchSection(sec.name);
 
-      if(current == 2){
-
-        size_t pos = 0;
-        string delimiter = "\t";
-        vector<string> params;
-
-        for(int j = 0; j < 4; j++){
-          pos = line.find(delimiter);
-          string token = line.substr(0, pos);
-          line.erase(0, pos + delimiter.length());
-          if(token != "") params.push_back(token);
-        }
-
-        if(params.size() == 4){
-          if(params[0] == params[1]){
-            Relocations relos;
-            relos.name = params[0];
-            relos.fileName = s;
-            currentRelocations = allRelocations.size();
-            allRelocations.push_back(relos);
-          } else {
-            Relocation relo;
-
-            sscanf(params[0].c_str(), "%X", &relo.offset);
-            if(params[1] == "R_16") relo.type = R_16;
-            else if(params[1] == "R_PC16") relo.type = R_PC16;
-            else if(params[1] == "R_WORD16") relo.type = R_WORD16;
-            relo.symbolId = stoi(params[2]);
-
-            int num;
-            sscanf(params[3].substr(0,1).c_str(), "%X", &num);
-            if(num >= 8){
-              params[3] = "FFFF" + params[3];
-            }
-
-            sscanf(params[3].c_str(), "%X", &relo.addend);
-
-            for(Symbol s: Symbols){
-              if(s.symbolName == currentSymbols[relo.symbolId].symbolName){
-                relo.symbolId = s.id;
-                break;
-              }
-            }
-
-            allRelocations[currentRelocations].relocations.push_back(relo);
-          }
-        } 
+    if(i == -1){  // new section, add to sections
+      i = sec.id = Sections.size();
+      addSection(sec);
+    } else {      // section already exists, add to size only
+      Sections[i].size += sec.size;
+    }
 
-      }
+    if(k == 0) continue;
+    input.code[k - 1].sectionId = i;
+    allMachineCode.push_back(input.code[k - 1]);
+  }
 
-      if(current == 3){
-        size_t pos = 0;
-        string delimiter = " ";
-        vector<string> params;
-
-        if((pos = line.find(delimiter)) == std::string::npos){
-          params.push_back(line);
-        }
-
-        while((pos = line.find(delimiter)) != std::string::npos){
-          string token = line.substr(0, pos);
-          line.erase(0, pos + delimiter.length());
-          params.push_back(token);
-        }
-
-        if(params.size() == 1 && turn){
-          MachineCode mc;
-          mc.sectionName = params[0];
-          mc.fileName = s;
-          currentMC = allMachineCode.size();
-          allMachineCode.push_back(mc);
-          turn = false;
-        } else {
-          allMachineCode[currentMC].code = params;
-          turn = true;
-        }
+  vector<int> localToGlobal(input.symbols.size());    // index of symbol in this file -> index in Symbols
+  vector<int> sectionFixups;        // symbols whose sectionId is still index of section symbol in this file
 
+  for(size_t k = 0; k < input.symbols.size(); k++){
+    Symbol symb = input.symbols[k];
+    if(symb.contribution != -1) symb.contribution += codeBase;
+
+    int i = searchSymbol(symb.symbolName);
+
+    if(i == -1){
+      i = Symbols.size();
+      symb.id = i;
+      if(symb.type == SCTN){ 
+        symb.sectionId = symb.id;
+      } else if(symb.sectionId != OBJECT_UND_SECTION){
+        sectionFixups.push_back(i);
       }
+      addSymbol(symb);
 
+    } else {
+      if(Symbols[i].defined && symb.defined){
+        return -3;
+      }
+      if(!Symbols[i].defined && symb.defined){
+        Symbols[i].defined = true;
+        Symbols[i].offset = symb.offset;
+        Symbols[i].sectionId = symb.sectionId;
+        Symbols[i].fileName = symb.fileName;
+        Symbols[i].contribution = symb.contribution;
+        sectionFixups.push_back(i);
+      }
     }
+    localToGlobal[k] = i;
 
-    inputFile.close();
+  }
+
+  // section symbol can come after symbols of its section, so sections are resolved when whole table is read
+  for(int i: sectionFixups){
+    Symbols[i].sectionId = localToGlobal[Symbols[i].sectionId];
+  }
+
+  for(Relocations& relos: input.relocations){
+    relos.contribution += codeBase;
+    for(Relocation& relo: relos.relocations){
+      relo.symbolId = localToGlobal[relo.symbolId];
+    }
+    allRelocations.push_back(std::move(relos));
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Linker links all input files, files are parsed in parallel and merged in order
+ * 
+ * @return int 0 - everything is okay, -1 - wrong terminal input, -2 - some input files don't exist,
+ * -3 - multiple definition of symbol, -4 - undefined symbol, -5 - input file isn't valid object file,
+ * -6 - memory image or symbol map couldn't be written, -7 - sections overlap or don't fit in memory
+ */
+int Linker::link(){
+
+  inputs.resize(inputFileStrings.size());
+  parallelFor(inputs.size(), options.threads, [this](size_t i){ parseObject(i); });
+
+  for(const ObjectInput& input: inputs){
+    if(input.error != 0) return input.error;
+  }
+
+  for(size_t i = 0; i < inputs.size(); i++){
+    int ret = mergeObject(i);
+    if(ret != 0) return ret;
   }
 
   bool ret = checkForUNDSymbols();
   if(ret) return -4;
 
-  setGoodCode();
+  if(!setGoodCode()) return -7;
   setSymbolOffset();
   doRelocations();
 
   printHelpFile();
+  if(options.mapFile != "" && !writeMap()) return -6;
+  if(options.binary){
+    if(!writeImage()) return -6;
+  } else {
+    printHex();
+  }
 
   return 0;
 
@@ -646,28 +687,39 @@ int main(int argc, char const *argv[]){
 
   try{
 
-    if(!argv[1] || !argv[2] || !argv[3]) throw InputException();
+    Linker::Options options;
+    vector<string> args;
 
-    string option1 = argv[1];
-    string option2 = argv[2];
-    string outputFile = argv[3];
-    vector<string> inputFiles;
-    int i = 4;
-    while(argv[i]){
-      inputFiles.push_back(argv[i]);
-      i++;
+    for(int i = 1; i < argc; i++){
+      string arg = argv[i];
+      if(arg[0] == '-' && arg != "-hex" && arg != "-binary" && arg != "-o"){
+        if(!checkOption(arg, options)) throw InputException();
+      } else {
+        args.push_back(arg);
+      }
     }
 
+    if(args.size() < 3) throw InputException();
+
+    string option1 = args[0];
+    string option2 = args[1];
+    string outputFile = args[2];
+    vector<string> inputFiles(args.begin() + 3, args.end());
+
     if(!checkInputData(option1, option2, outputFile, inputFiles)){
       throw InputException();
     }
 
-    Linker linker(inputFiles, outputFile);
+    options.binary = option1 == "-binary";
+    Linker linker(inputFiles, outputFile, options);
     int ret = linker.link();
 
     if(ret == -2) throw InputException();
     if(ret == -3) throw MulitpleDefinitionOfSymbolException();
     if(ret == -4) throw UndefinedSymbolException();
+    if(ret == -5) throw InvalidObjectFileException();
+    if(ret == -6) throw ImageException();
+    if(ret == -7) throw SectionPlacementException();
   }
   catch(const exception& e){
 
@@ -5,6 +5,14 @@
 #include <regex>
 #include <fstream>
 #include <iomanip>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <thread>
+#include <algorithm>
+#include "../common/object.hpp"
+#include "../common/image.hpp"
+#include "../common/parallel.hpp"
 
 using namespace std;
 
@@ -12,18 +20,27 @@ class Linker{
 
 public:
 
-  Linker(vector<string> inputFileStrings, string outputFileString);
+  struct Options{
+    unsigned threads = 0;             // 0 - one thread per hardware thread
+    bool binary = false;              // -binary, raw memory image instead of hex
+    unordered_map<string, int> places;    // -place=<section>@<address>, section name -> address
+    string mapFile;                   // -map=<file>, empty - no symbol map
+  };
+
+  Linker(vector<string> inputFileStrings, string outputFileString, Options options);
   int link();
 
 private:
 
   bool openFiles();
   void printHelpFile();
+  void printHex();
+  bool writeImage();
+  bool writeMap();
   bool checkForUNDSymbols();
-  void setGoodCode();
+  bool setGoodCode();
   void setSymbolOffset();
   void doRelocations();
-  vector<string> decToCode(string num);
 
   enum SymbolType{NOTYP, SCTN};
   enum SymbolBind{GLOBAL, LOCAL, NOBIND};
@@ -31,17 +48,20 @@ private:
 
   vector<string> inputFileStrings;
   string outputFileString;
-  ifstream inputFile;
+  Options options;
   ofstream outputFile;
 
   struct Section{
     int id;
     int size;
-    string name;
+    int base;                       // address of section in output image
+    string_view name;
   };
 
   vector<Section> Sections;
-  int searchSection(Section sec);
+  unordered_map<string_view, int> sectionIndex;   // section name -> index in Sections
+  int searchSection(string_view name);
+  void addSection(const Section& sec);
 
   struct Symbol{
     int id;
@@ -49,13 +69,16 @@ private:
     SymbolType type;
     SymbolBind bind;
     int sectionId;
-    string symbolName;
+    string_view symbolName;
     bool defined;
-    string fileName;
+    string_view fileName;
+    int contribution;               // index in allMachineCode of code where symbol is defined, -1 if none
   };
 
   vector<Symbol> Symbols;
-  int searchSymbol(Symbol symb);
+  unordered_map<string_view, int> symbolIndex;    // symbol name -> index in Symbols
+  int searchSymbol(string_view name);
+  void addSymbol(const Symbol& symb);
 
   struct Relocation{
     int offset;
@@ -65,20 +88,40 @@ private:
   };
 
   struct Relocations{
-    string name;
-    string fileName;
+    string_view name;
+    string_view fileName;
+    int contribution;               // index in allMachineCode of code that relocations patch
     vector<Relocation> relocations;
   };
 
   vector<Relocations> allRelocations;
+  void applyRelocations(const Relocations& relos);
 
   struct MachineCode{
-    string sectionName;
-    string fileName;
-    vector<string> code;
-    // int start;
+    string_view sectionName;
+    string_view fileName;
+    const uint8_t* code;
+    size_t size;
+    int sectionId;                  // index in Sections
+    int base;                       // address of this code in output image
   };
 
   vector<MachineCode> allMachineCode;
-  vector<MachineCode> goodMachineCode;
+
+  // One input file after it is parsed, symbols and relocations still use indexes of this file
+  // and contributions are indexes in code. Names and code point into mapped object.
+  struct ObjectInput{
+    ObjectView object;
+    int error = 0;                  // 0, -2 or -5 like link()
+    vector<Section> sections;
+    vector<Symbol> symbols;
+    vector<Relocations> relocations;
+    vector<MachineCode> code;       // code of sections 1 ... n
+  };
+
+  vector<ObjectInput> inputs;
+  void parseObject(size_t index);
+  int mergeObject(size_t index);
+  vector<uint8_t> image;            // linked code of all sections from address 0, gaps between segments are zero
+  vector<ImageRange> segments;      // populated parts of image, sorted by address
 };
\ No newline at end of file